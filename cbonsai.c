@@ -9,7 +9,10 @@
 #include <wchar.h>
 #include <ctype.h>
 #include <errno.h>
+#include <signal.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
 
 #ifdef _WIN32
     #define WIN32_LEAN_AND_MEAN
@@ -136,10 +139,111 @@
     #include <panel.h>
     #include <getopt.h>
     #include <unistd.h>
+    #include <pthread.h>
+    #include <sys/ioctl.h>
+    #include <poll.h>
+    #include <termios.h>
 #endif
 
 #include "cbonsai.h"
 
+#ifdef CBONSAI_LAZY_CURSES
+#include <dlfcn.h>
+
+// curses is only loaded, with dlopen(), once something is going to be drawn
+// with it: printing a tree never needs it. Everything curses that's used
+// below goes through this table, filled in by loadCurses()
+#define CURSES_SYMBOLS(X) \
+	X(COLORS) X(COLS) X(LINES) X(newscr) X(stdscr) \
+	X(cbreak) X(curs_set) X(del_panel) X(delwin) X(doupdate) X(endwin) \
+	X(getcchar) X(has_colors) X(hide_panel) X(init_pair) X(initscr) \
+	X(move_panel) X(mvwprintw) X(new_panel) X(newwin) X(nodelay) X(noecho) \
+	X(overlay) X(overwrite) X(pair_content) X(resizeterm) X(savetty) \
+	X(show_panel) X(start_color) X(top_panel) X(ungetch) X(update_panels) \
+	X(use_default_colors) X(waddnstr) X(wattr_on) X(wattrset) X(wborder) \
+	X(wclear) X(werase) X(wgetch) X(win_wch) X(winch) X(wmove) X(wrefresh) \
+	X(wresize) X(wtimeout)
+
+#define CURSES_POINTER(name) __typeof__(name) *name;
+
+struct cursesLibrary {
+	int loaded;	// 1 once loaded, -1 if it can't be
+	CURSES_SYMBOLS(CURSES_POINTER)
+};
+
+struct cursesLibrary curses;
+
+// returns 1 once curses can be used; the panel library brings curses
+// (and terminfo) along with it
+int loadCurses(void) {
+	static const char *libraries[] = { "libpanelw.so.6", "libpanelw.so.5", "libpanelw.so" };
+	if (curses.loaded) return curses.loaded > 0;
+	curses.loaded = -1;
+
+	void *lib = NULL;
+	for (size_t i = 0; !lib && i < sizeof(libraries) / sizeof(libraries[0]); i++)
+		lib = dlopen(libraries[i], RTLD_NOW | RTLD_LOCAL);
+	if (!lib) return 0;
+
+#define CURSES_LOOKUP(name) { \
+		void *symbol = dlsym(lib, #name); \
+		if (!symbol) return 0; \
+		memcpy(&curses.name, &symbol, sizeof(symbol)); \
+	}
+	CURSES_SYMBOLS(CURSES_LOOKUP)
+
+	curses.loaded = 1;
+	return 1;
+}
+
+#define COLORS (*curses.COLORS)
+#define COLS (*curses.COLS)
+#define LINES (*curses.LINES)
+#define newscr (*curses.newscr)
+#define stdscr (*curses.stdscr)
+#define cbreak (*curses.cbreak)
+#define curs_set (*curses.curs_set)
+#define del_panel (*curses.del_panel)
+#define delwin (*curses.delwin)
+#define doupdate (*curses.doupdate)
+#define endwin (*curses.endwin)
+#define getcchar (*curses.getcchar)
+#define has_colors (*curses.has_colors)
+#define hide_panel (*curses.hide_panel)
+#define init_pair (*curses.init_pair)
+#define initscr (*curses.initscr)
+#define move_panel (*curses.move_panel)
+#define mvwprintw (*curses.mvwprintw)
+#define new_panel (*curses.new_panel)
+#define newwin (*curses.newwin)
+#define nodelay (*curses.nodelay)
+#define noecho (*curses.noecho)
+#define overlay (*curses.overlay)
+#define overwrite (*curses.overwrite)
+#define pair_content (*curses.pair_content)
+#define resizeterm (*curses.resizeterm)
+#define savetty (*curses.savetty)
+#define show_panel (*curses.show_panel)
+#define start_color (*curses.start_color)
+#define top_panel (*curses.top_panel)
+#define ungetch (*curses.ungetch)
+#define update_panels (*curses.update_panels)
+#define use_default_colors (*curses.use_default_colors)
+#define waddnstr (*curses.waddnstr)
+#define wattr_on (*curses.wattr_on)
+#define wattrset (*curses.wattrset)
+#define wborder (*curses.wborder)
+#define wclear (*curses.wclear)
+#define werase (*curses.werase)
+#define wgetch (*curses.wgetch)
+#define win_wch (*curses.win_wch)
+#define winch (*curses.winch)
+#define wmove (*curses.wmove)
+#define wrefresh (*curses.wrefresh)
+#define wresize (*curses.wresize)
+#define wtimeout (*curses.wtimeout)
+#endif
+
 enum branchType {trunk, shootLeft, shootRight, dying, dead};
 
 struct config {
@@ -157,6 +261,13 @@ struct config {
 	int save;
 	int load;
 	int targetBranchCount;
+	int skipOverdraw;
+	int budget;
+	int jobs;
+	int forest;
+	int scan;
+	int diffRender;
+	int asciiLeaves;	// every leaf is plain ascii, strokes need no locale conversion
 
 	double timeWait;
 	double timeStep;
@@ -165,15 +276,26 @@ struct config {
 	char* leaves[64];
 	char* saveFile;
 	char* loadFile;
+	char* search;
+	char* recordFile;
+	char* replayFile;
+
+	FILE* recording;	// open while recording
+	double recordTime;	// where in the recording the next frame goes
+
+	struct buffer *render;	// where print mode writes instead of stdout, if set
+	int rows, cols;		// size of the screen to print for, 0 for the terminal's
 };
 
+#define MAX_FOREST 16	// most trees grown side by side
+
 struct ncursesObjects {
-	WINDOW* baseWin;
+	WINDOW* baseWin[MAX_FOREST];
 	WINDOW* treeWin;
 	WINDOW* messageBorderWin;
 	WINDOW* messageWin;
 
-	PANEL* basePanel;
+	PANEL* basePanel[MAX_FOREST];
 	PANEL* treePanel;
 	PANEL* messageBorderPanel;
 	PANEL* messagePanel;
@@ -182,24 +304,228 @@ struct ncursesObjects {
 struct counters {
 	int branches;
 	int shoots;
-	int shootCounter;
+	int steps;	// growth steps taken, checked against the budget
+
+	// occupancy statistics
+	int cells;	// distinct cells painted
+	int overdraw;	// cell paints that landed on an occupied cell
+	int skipped;	// leaf steps skipped because their cell was already leafy
+
+	int dropped;	// live frames merged into later ones because the terminal lagged
+};
+
+// one printed piece of a branch, in tree-relative coordinates:
+// (0, 0) is where the trunk leaves the ground, negative y is up
+struct stroke {
+	int y;
+	int x;
+	int width;		// display columns covered by str
+	int branch;		// branches started so far when it was grown
+	unsigned char type;	// branch type that grew it
+	unsigned char color;	// color pair, 0 for none
+	unsigned char bold;
+	unsigned char ascii;	// str is plain ascii, a byte per column
+	char str[32];
+};
+
+// what was last drawn on a cell: which column of which stroke
+struct gridCell {
+	unsigned char type;	// branch type + 1 of the stroke, 0 if empty
+	unsigned char column;	// column of the stroke that landed here
+	unsigned int stroke;	// index of the stroke in the tree
+};
+
+// which cells the tree covers, in tree-relative coordinates; grows on demand
+struct grid {
+	int originY, originX;	// tree-relative coordinates of cells[0]
+	int height, width;
+	struct gridCell *cells;
+};
+
+// grown tree geometry, independent of any terminal size
+struct tree {
+	struct stroke *strokes;
+	size_t count;
+	size_t capacity;
+
+	// bounding box of all strokes (inclusive)
+	int minY, maxY;
+	int minX, maxX;
+
+	struct grid occupancy;
+};
+
+void gridReset(struct grid *grid) {
+	if (grid->cells) memset(grid->cells, 0, (size_t) grid->height * grid->width * sizeof(*grid->cells));
+}
+
+void gridFree(struct grid *grid) {
+	free(grid->cells);
+	grid->cells = NULL;
+	grid->height = grid->width = 0;
+}
+
+// make sure row y, columns x0..x1 are inside the grid
+int gridReserve(struct grid *grid, int y, int x0, int x1) {
+	if (grid->cells && y >= grid->originY && y < grid->originY + grid->height &&
+			x0 >= grid->originX && x1 < grid->originX + grid->width)
+		return 0;
+
+	// grow to cover the new cells with room to spare on every side
+	int top = grid->cells ? grid->originY : y;
+	int bottom = grid->cells ? grid->originY + grid->height - 1 : y;
+	int left = grid->cells ? grid->originX : x0;
+	int right = grid->cells ? grid->originX + grid->width - 1 : x1;
+	if (y < top) top = y;
+	if (y > bottom) bottom = y;
+	if (x0 < left) left = x0;
+	if (x1 > right) right = x1;
+
+	int height = (bottom - top + 1) * 2;
+	int width = (right - left + 1) * 2;
+	if (height < 64) height = 64;
+	if (width < 128) width = 128;
+	int originY = top - (height - (bottom - top + 1)) / 2;
+	int originX = left - (width - (right - left + 1)) / 2;
+
+	struct gridCell *cells = calloc((size_t) height * width, sizeof(*cells));
+	if (!cells) return 1;
+
+	for (int row = 0; row < grid->height; row++) {
+		memcpy(cells + (size_t) (grid->originY + row - originY) * width + (grid->originX - originX),
+			grid->cells + (size_t) row * grid->width, grid->width * sizeof(*cells));
+	}
+
+	free(grid->cells);
+	grid->cells = cells;
+	grid->originY = originY;
+	grid->originX = originX;
+	grid->height = height;
+	grid->width = width;
+	return 0;
+}
+
+// what was last drawn on a cell, NULL if it's outside the grid
+const struct gridCell* gridCellAt(const struct grid *grid, int y, int x) {
+	y -= grid->originY;
+	x -= grid->originX;
+	if (!grid->cells || y < 0 || y >= grid->height || x < 0 || x >= grid->width) return NULL;
+	return &grid->cells[(size_t) y * grid->width + x];
+}
+
+// what occupies a cell, 0 if nothing does
+int gridGet(const struct grid *grid, int y, int x) {
+	const struct gridCell *cell = gridCellAt(grid, y, x);
+	return cell ? cell->type : 0;
+}
+
+// mark the cells under stroke number index, update the occupancy statistics
+void gridMark(struct grid *grid, const struct stroke *stroke, unsigned int index, struct counters *myCounters) {
+	if (stroke->width <= 0) return;
+	if (gridReserve(grid, stroke->y, stroke->x, stroke->x + stroke->width - 1) != 0) return;
+
+	struct gridCell *cell = grid->cells + (size_t) (stroke->y - grid->originY) * grid->width + (stroke->x - grid->originX);
+	for (int i = 0; i < stroke->width; i++) {
+		if (cell[i].type) myCounters->overdraw++;
+		else myCounters->cells++;
+		cell[i].type = stroke->type + 1;
+		cell[i].column = (unsigned char) i;
+		cell[i].stroke = index;
+	}
+}
+
+void treeReset(struct tree *tree) {
+	tree->count = 0;
+	tree->minY = tree->maxY = 0;
+	tree->minX = tree->maxX = 0;
+	gridReset(&tree->occupancy);
+}
+
+void treeFree(struct tree *tree) {
+	free(tree->strokes);
+	tree->strokes = NULL;
+	tree->capacity = 0;
+	treeReset(tree);
+	gridFree(&tree->occupancy);
+}
+
+// append a stroke and grow the bounding box, returns the stored copy
+struct stroke* treeAdd(struct tree *tree, const struct stroke *stroke) {
+	if (tree->count == tree->capacity) {
+		size_t newCapacity = tree->capacity ? tree->capacity * 2 : 256;
+		struct stroke *newStrokes = realloc(tree->strokes, newCapacity * sizeof(*newStrokes));
+		if (!newStrokes) return NULL;
+		tree->strokes = newStrokes;
+		tree->capacity = newCapacity;
+	}
+
+	if (tree->count == 0) {
+		tree->minY = tree->maxY = stroke->y;
+		tree->minX = stroke->x;
+		tree->maxX = stroke->x + stroke->width - 1;
+	} else {
+		if (stroke->y < tree->minY) tree->minY = stroke->y;
+		if (stroke->y > tree->maxY) tree->maxY = stroke->y;
+		if (stroke->x < tree->minX) tree->minX = stroke->x;
+		if (stroke->x + stroke->width - 1 > tree->maxX) tree->maxX = stroke->x + stroke->width - 1;
+	}
+
+	tree->strokes[tree->count] = *stroke;
+	return &tree->strokes[tree->count++];
+}
+
+// counter-based random stream: every draw is a pure function of (key, counter),
+// so what one branch draws never depends on what any other branch drew
+struct rng {
+	uint64_t key;
+	uint64_t counter;
 };
 
+#define STEP_DRAWS 8	// draws reserved for every growth step of a branch
+
+uint64_t mix64(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+uint64_t rngNext(struct rng *rng) {
+	return mix64(rng->key + ++rng->counter * 0x9e3779b97f4a7c15ULL);
+}
+
+// uniform integer in [0, mod)
+int rngInt(struct rng *rng, int mod) {
+	return (int) (((rngNext(rng) >> 32) * (uint64_t) mod) >> 32);
+}
+
+// stream of the branch spawned at a given step of its parent
+struct rng rngChild(const struct rng *parent, int step) {
+	struct rng child = { mix64(parent->key ^ mix64((uint64_t) step)), 0 };
+	return child;
+}
+
 void delObjects(struct ncursesObjects *objects) {
 	// delete panels (check for NULL first)
-	if (objects->basePanel) del_panel(objects->basePanel);
+	for (int i = 0; i < MAX_FOREST; i++)
+		if (objects->basePanel[i]) del_panel(objects->basePanel[i]);
 	if (objects->treePanel) del_panel(objects->treePanel);
 	if (objects->messageBorderPanel) del_panel(objects->messageBorderPanel);
 	if (objects->messagePanel) del_panel(objects->messagePanel);
 
 	// delete windows (check for NULL first)
-	if (objects->baseWin) delwin(objects->baseWin);
+	for (int i = 0; i < MAX_FOREST; i++)
+		if (objects->baseWin[i]) delwin(objects->baseWin[i]);
 	if (objects->treeWin) delwin(objects->treeWin);
 	if (objects->messageBorderWin) delwin(objects->messageBorderWin);
 	if (objects->messageWin) delwin(objects->messageWin);
+
+	memset(objects, 0, sizeof(*objects));
 }
 
+void stopRecording(struct config *conf);
+
 void quit(struct config *conf, struct ncursesObjects *objects, int returnCode) {
+	stopRecording(conf);
 	delObjects(objects);
 	free(conf->saveFile);
 	free(conf->loadFile);
@@ -278,119 +604,208 @@ void printHelp(void) {
 	        "  -s, --seed=INT         seed random number generator\n"
 	        "  -W, --save=FILE        save progress to file [default: $XDG_CACHE_HOME/cbonsai or $HOME/.cache/cbonsai]\n"
 	        "  -C, --load=FILE        load progress from file [default: $XDG_CACHE_HOME/cbonsai]\n"
+	        "  -O, --skip-overdraw    don't repaint cells that already show the same\n"
+	        "                           glyph and color (faster, same output)\n"
+	        "  -B, --budget=INT       prune growth after about INT steps, so large -L/-M\n"
+	        "                           values still finish quickly [default: unlimited]\n"
+	        "  -j, --jobs=INT         grow subtrees on INT threads, 0 for one per CPU\n"
+	        "                           [default: 1]\n"
+	        "  -F, --forest=INT       grow INT trees side by side (1-16), 0 for one\n"
+	        "                           per 80 columns [default: 1]\n"
+	        "  -X, --search=FILTER    grow trees for --scan seeds from --seed on, without\n"
+	        "                           a screen, and list the seeds whose trees pass\n"
+	        "                           FILTER, e.g. 'height>=20,width<=60,symmetry>50';\n"
+	        "                           fields: height, width, cells, leaves (% of\n"
+	        "                           cells), symmetry (% of cells), branches\n"
+	        "  -N, --scan=INT         seeds to try with --search [default: 10000]\n"
+	        "  -R, --record=FILE      record what is shown to FILE as an asciicast v2\n"
+	        "                           recording\n"
+	        "  -r, --replay=FILE      play a recording made with --record back, without\n"
+	        "                           growing anything\n"
+	        "  -d, --diff-render      draw with cbonsai's own renderer, which only sends\n"
+	        "                           the cells that change, instead of curses\n"
 	        "  -v, --verbose          increase output verbosity\n"
 	        "  -h, --help             show help\n"
     );
 }
 
+// how the trunk grows out of a base: straight up out of a pot, or curving
+// out of a mound
+enum trunkStyle {trunkUpright, trunkRooted};
+
+// ascii-art plant bases; every character of the art has a color pair in the
+// matching colors row (a hex digit), ' ' where nothing is drawn
+struct baseArt {
+	int height, width;
+	int bold;
+	const char *rows[4];
+	const char *colors[4];
+	enum trunkStyle trunk;
+};
+
+const struct baseArt baseArts[] = {
+	{ 0, 0, 0, { NULL }, { NULL }, trunkUpright },
+	{ 4, 31, 1, {
+		":___________./~~~\\.___________:",
+		" \\                           / ",
+		"  \\_________________________/ ",
+		"  (_)                     (_)",
+	}, {
+		"822222222222bbbbbbb222222222228",
+		"8888888888888888888888888888888",
+		"888888888888888888888888888888",
+		"88888888888888888888888888888",
+	}, trunkUpright },
+	{ 3, 15, 0, {
+		"(---./~~~\\.---)",
+		" (           ) ",
+		"  (_________)  ",
+	}, {
+		"8222bbbbbbb2228",
+		"888888888888888",
+		"888888888888888",
+	}, trunkUpright },
+	{ 4, 35, 0, {
+		"                ###",
+		"               #####",
+		"              *#####*",
+		".::--==++****#########****++==--::.",
+	}, {
+		"                333",
+		"               33333",
+		"              8333338",
+		"88888888833333333333333333888888888",
+	}, trunkRooted },
+};
+
+#define BASE_TYPES ((int) (sizeof(baseArts) / sizeof(baseArts[0])))
+
+// color pair of a colors row character, a hex digit
+int baseColor(char c) {
+	return isdigit((unsigned char) c) ? c - '0' : c - 'a' + 10;
+}
+
 void drawBase(WINDOW* baseWin, int baseType) {
-	// draw base art
-	switch(baseType) {
-	case 1:
-		wattron(baseWin, A_BOLD | COLOR_PAIR(8));
-		wprintw(baseWin, "%s", ":");
-		wattron(baseWin, COLOR_PAIR(2));
-		wprintw(baseWin, "%s", "___________");
-		wattron(baseWin, COLOR_PAIR(11));
-		wprintw(baseWin, "%s", "./~~~\\.");
-		wattron(baseWin, COLOR_PAIR(2));
-		wprintw(baseWin, "%s", "___________");
-		wattron(baseWin, COLOR_PAIR(8));
-		wprintw(baseWin, "%s", ":");
-
-		mvwprintw(baseWin, 1, 0, "%s", " \\                           / ");
-		mvwprintw(baseWin, 2, 0, "%s", "  \\_________________________/ ");
-		mvwprintw(baseWin, 3, 0, "%s", "  (_)                     (_)");
-
-		wattroff(baseWin, A_BOLD);
-		break;
-	case 2:
-		wattron(baseWin, COLOR_PAIR(8));
-		wprintw(baseWin, "%s", "(");
-		wattron(baseWin, COLOR_PAIR(2));
-		wprintw(baseWin, "%s", "---");
-		wattron(baseWin, COLOR_PAIR(11));
-		wprintw(baseWin, "%s", "./~~~\\.");
-		wattron(baseWin, COLOR_PAIR(2));
-		wprintw(baseWin, "%s", "---");
-		wattron(baseWin, COLOR_PAIR(8));
-		wprintw(baseWin, "%s", ")");
-
-		mvwprintw(baseWin, 1, 0, "%s", " (           ) ");
-		mvwprintw(baseWin, 2, 0, "%s", "  (_________)  ");
-		break;
-	case 3:
-		// draw trunk base and roots - trunk tapers from narrow top to wide roots
-		// Row 0: trunk continuation (bridges gap from tree window)
-		wattron(baseWin, COLOR_PAIR(3));
-		mvwprintw(baseWin, 0, 16, "%s", "###");
-		// Row 1: trunk slightly widens
-		mvwprintw(baseWin, 1, 15, "%s", "#####");
-		// Row 2: trunk base widens more
-		wattron(baseWin, COLOR_PAIR(8));
-		mvwprintw(baseWin, 2, 14, "%s", "*");
-		wattron(baseWin, COLOR_PAIR(3));
-		mvwprintw(baseWin, 2, 15, "%s", "#####");
-		wattron(baseWin, COLOR_PAIR(8));
-		mvwprintw(baseWin, 2, 20, "%s", "*");
-		// Row 3: roots spread out
-		mvwprintw(baseWin, 3, 0, "%s", ".::--==++");
-		wattron(baseWin, COLOR_PAIR(3));
-		mvwprintw(baseWin, 3, 9, "%s", "****#########****");
-		wattron(baseWin, COLOR_PAIR(8));
-		mvwprintw(baseWin, 3, 26, "%s", "++==--::.");
-		wattroff(baseWin, COLOR_PAIR(8));
-		break;
+	const struct baseArt *art = &baseArts[baseType];
+
+	// draw base art, a run of one color at a time
+	for (int row = 0; row < art->height; row++) {
+		const char *text = art->rows[row];
+		const char *colors = art->colors[row];
+		for (int x = 0; text[x]; ) {
+			int run = 1;
+			while (text[x + run] && colors[x + run] == colors[x]) run++;
+			if (colors[x] != ' ') {
+				wattrset(baseWin, COLOR_PAIR(baseColor(colors[x])) | (art->bold ? A_BOLD : 0));
+				mvwaddnstr(baseWin, row, x, text + x, run);
+			}
+			x += run;
+		}
 	}
+	wattrset(baseWin, A_NORMAL);
 }
 
-void drawWins(int baseType, struct ncursesObjects *objects) {
-	int baseWidth = 0;
-	int baseHeight = 0;
-	int rows, cols;
+// trees in the forest; 0 asks for one per 80 columns of screen
+int forestSize(const struct config *conf, int cols) {
+	if (conf->forest > 0) return conf->forest;
+	int forest = cols / 80;
+	if (forest < 1) forest = 1;
+	if (forest > MAX_FOREST) forest = MAX_FOREST;
+	return forest;
+}
 
-	switch(baseType) {
-	case 1:
-		baseWidth = 31;
-		baseHeight = 4;
-		break;
-	case 2:
-		baseWidth = 15;
-		baseHeight = 3;
-		break;
-	case 3:
-		baseWidth = 35;
-		baseHeight = 4;
-		break;
-	}
+// column of the n-th of count trees spread evenly across a width
+int forestColumn(int width, int index, int count) {
+	return (2 * index + 1) * width / (2 * count);
+}
+
+void drawWins(int baseType, int forest, struct ncursesObjects *objects) {
+	int baseWidth = baseArts[baseType].width;
+	int baseHeight = baseArts[baseType].height;
+	int rows, cols;
 
 	// calculate where base should go
 	getmaxyx(stdscr, rows, cols);
 	int baseOriginY = (rows - baseHeight);
 	// base 3 needs to overlap 1 row higher to connect with trunk (tree draws after moving)
 	if (baseType == 3) baseOriginY -= 1;
-	int baseOriginX = (cols / 2) - (baseWidth / 2);
 
 	// clean up old objects
 	delObjects(objects);
 
 	// create windows
-	objects->baseWin = newwin(baseHeight, baseWidth, baseOriginY, baseOriginX);
 	objects->treeWin = newwin(rows - baseHeight, cols, 0, 0);
-
-	// create tree and base panels (base panel last so it's on top for overlap)
 	objects->treePanel = new_panel(objects->treeWin);
-	objects->basePanel = new_panel(objects->baseWin);
 
-	drawBase(objects->baseWin, baseType);
+	// one base under every tree (base panels last so they're on top for overlap)
+	if (baseWidth == 0) return;
+	for (int i = 0; i < forest; i++) {
+		int baseOriginX = forestColumn(cols, i, forest) - (baseWidth / 2);
+		objects->baseWin[i] = newwin(baseHeight, baseWidth, baseOriginY, baseOriginX);
+		objects->basePanel[i] = new_panel(objects->baseWin[i]);
+		drawBase(objects->baseWin[i], baseType);
+	}
+}
+
+#ifndef _WIN32
+// size of the terminal, or what the environment says if it can't be asked
+void terminalSize(int *rows, int *cols) {
+	struct winsize size;
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+		*rows = size.ws_row;
+		*cols = size.ws_col;
+		return;
+	}
+
+	const char *lines = getenv("LINES");
+	const char *columns = getenv("COLUMNS");
+	*rows = lines && atoi(lines) > 0 ? atoi(lines) : 24;
+	*cols = columns && atoi(columns) > 0 ? atoi(columns) : 80;
+}
+
+// size of the screen to lay out for: the terminal's, unless one was asked for
+void screenSize(const struct config *conf, int *rows, int *cols) {
+	terminalSize(rows, cols);
+	if (conf->rows > 0) *rows = conf->rows;
+	if (conf->cols > 0) *cols = conf->cols;
+}
+#endif
+
+// set when the terminal is resized; SIGWINCH is handled here rather than by
+// curses, so both renderers find out the same way and fit what's already
+// grown to the new size
+volatile sig_atomic_t terminalResized = 0;
+
+#ifdef SIGWINCH
+void onResize(int sig) {
+	(void) sig;
+	terminalResized = 1;
+}
+#endif
+
+void watchResize(void) {
+#ifdef SIGWINCH
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onResize;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGWINCH, &action, NULL);
+#endif
 }
 
-// roll (randomize) a given die
-void roll(int *dice, int mod) { *dice = rand() % mod; }
+// whether a key ends cbonsai: any key in screensaver mode, otherwise 'q'
+int quitKey(const struct config *conf, int key) {
+	return (conf->screensaver && key != ERR && key != KEY_RESIZE) || key == 'q';
+}
 
 // check for key press
 int checkKeyPress(const struct config *conf, struct counters *myCounters) {
-	if ((conf->screensaver && wgetch(stdscr) != ERR) || (wgetch(stdscr) == 'q')) {
+	int key = wgetch(stdscr);
+
+	// PDCurses tells of a resize with a key rather than a signal
+	if (key == KEY_RESIZE) terminalResized = 1;
+
+	if (quitKey(conf, key)) {
 		finish(conf, myCounters);
 		return 1;
 	}
@@ -414,26 +829,545 @@ void updateScreen(float timeStep) {
 #endif
 }
 
+// seconds on a clock that only moves forward
+double monotonicTime(void) {
+#ifdef _WIN32
+	return GetTickCount64() / 1000.0;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+// sleep until a monotonicTime() that may already have passed
+void sleepUntil(double when) {
+	double wait = when - monotonicTime();
+	if (wait <= 0) return;
+
+#ifdef _WIN32
+	Sleep((DWORD) (wait * 1000));
+#else
+	struct timespec ts;
+	ts.tv_sec = (time_t) wait;
+	ts.tv_nsec = (long) ((wait - ts.tv_sec) * 1000000000);
+	nanosleep(&ts, NULL);
+#endif
+}
+
+#define MAX_BACKLOG 1024	// bytes the terminal may fall behind before frames are merged
+
+// bytes written to the terminal that it hasn't taken yet; 0 where unknown
+int outputBacklog(void) {
+	int pending = 0;
+#ifdef TIOCOUTQ
+	if (ioctl(fileno(stdout), TIOCOUTQ, &pending) != 0) pending = 0;
+#endif
+	return pending;
+}
+
+// how far behind the terminal itself is, measured end to end: every frame
+// shown is followed by a status request ("\033[5n"), which the terminal
+// only answers ("\033[0n") once it has drawn everything sent before it
+struct terminalProbe {
+	int active;
+	int inFlight;		// requests not answered yet
+	int answered;
+	int matched;		// bytes of an answer read so far
+	double firstSent;
+};
+
+#define MAX_IN_FLIGHT 3	// frames the terminal may fall behind
+#define PROBE_TIMEOUT 2	// seconds to wait for an answer before giving up on them
+
+void probeStart(struct terminalProbe *probe) {
+	memset(probe, 0, sizeof(*probe));
+#ifndef _WIN32
+	probe->active = isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+#endif
+}
+
+// after a frame was sent
+void probeSend(struct terminalProbe *probe) {
+#ifndef _WIN32
+	if (!probe->active) return;
+	if (write(STDOUT_FILENO, "\033[5n", 4) != 4) return;
+	if (probe->firstSent == 0) probe->firstSent = monotonicTime();
+	probe->inFlight++;
+#else
+	(void) probe;
+#endif
+}
+
+// read what's waiting on the input, taking the answers out; returns the
+// number of other bytes (keys) left in keys
+int probeRead(struct terminalProbe *probe, unsigned char *keys, int size) {
+#ifndef _WIN32
+	static const char answer[] = "\033[0n";
+	int keyCount = 0;
+
+	struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+	unsigned char buf[64];
+	ssize_t n;
+	while (poll(&pfd, 1, 0) > 0 && (n = read(STDIN_FILENO, buf, sizeof(buf))) > 0) {
+		for (ssize_t i = 0; i < n; i++) {
+			if (probe->active && buf[i] == (unsigned char) answer[probe->matched]) {
+				if (++probe->matched < 4) continue;
+				probe->matched = 0;
+				probe->answered++;
+				if (probe->inFlight > 0) probe->inFlight--;
+				continue;
+			}
+
+			// not an answer after all
+			for (int j = 0; j < probe->matched && keyCount < size; j++) keys[keyCount++] = answer[j];
+			probe->matched = 0;
+			if (keyCount < size) keys[keyCount++] = buf[i];
+		}
+	}
+
+	// stop asking terminals that never answer
+	if (probe->answered == 0 && probe->firstSent != 0 && monotonicTime() - probe->firstSent > PROBE_TIMEOUT)
+		probe->active = 0;
+
+	return keyCount;
+#else
+	(void) probe;
+	(void) keys;
+	(void) size;
+	return 0;
+#endif
+}
+
+int probeBehind(const struct terminalProbe *probe) {
+	return probe->active && probe->answered > 0 && probe->inFlight > MAX_IN_FLIGHT;
+}
+
+// wait for the answers still on their way, so they don't reach curses as keys
+void probeFinish(struct terminalProbe *probe) {
+	double giveUp = monotonicTime() + PROBE_TIMEOUT;
+	unsigned char keys[64];
+	while (probe->active && probe->answered > 0 && probe->inFlight > 0 && monotonicTime() < giveUp) {
+		sleepUntil(monotonicTime() + 0.01);
+		probeRead(probe, keys, sizeof(keys));
+	}
+}
+
+// number of display columns a string takes up
+int strWidth(const char *str) {
+	int width = 0;
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+
+	while (*str) {
+		wchar_t wc;
+		size_t len = mbrtowc(&wc, str, MB_CUR_MAX, &state);
+		if (len == (size_t) -1 || len == (size_t) -2 || len == 0) break;
+
+		int cw = wcwidth(wc);
+		if (cw > 0) width += cw;
+		str += len;
+	}
+	return width;
+}
+
+// whether every leaf is printable ascii, a column per byte, so strokes can
+// skip mbrtowc and wcwidth
+int leavesAscii(const struct config *conf) {
+	int count = conf->leavesSize;
+	int maxLeaves = (int) (sizeof(conf->leaves) / sizeof(conf->leaves[0]));
+	if (count > maxLeaves) count = maxLeaves;
+
+	for (int i = 0; i < count; i++) {
+		for (const char *c = conf->leaves[i]; *c; c++)
+			if (*c < ' ' || *c > '~') return 0;
+	}
+	return 1;
+}
+
+// where tree-relative (0, 0) of the n-th tree of a forest lands in a window:
+// trunk centered over its base on the ground row
+void treeOrigin(WINDOW* win, int index, int forest, int *originY, int *originX) {
+	int maxY, maxX;
+	getmaxyx(win, maxY, maxX);
+	*originY = maxY - 1;
+	*originX = forestColumn(maxX, index, forest);
+}
+
+// draw a single stroke, clipping whatever falls outside the window
+void drawStroke(WINDOW* win, const struct stroke *stroke, int originY, int originX) {
+	int maxY, maxX;
+	getmaxyx(win, maxY, maxX);
+
+	int y = originY + stroke->y;
+	int x = originX + stroke->x;
+	if (y < 0 || y >= maxY || x >= maxX || x + stroke->width <= 0) return;
+
+	// ascii clips by the byte
+	if (stroke->ascii) {
+		int skip = x < 0 ? -x : 0;
+		int end = x + stroke->width > maxX ? maxX - x : stroke->width;
+		wattrset(win, COLOR_PAIR(stroke->color) | (stroke->bold ? A_BOLD : 0));
+		mvwaddnstr(win, y, x + skip, stroke->str + skip, end - skip);
+		wattrset(win, A_NORMAL);
+		return;
+	}
+
+	// find the run of characters that fits between the window edges
+	const char *str = stroke->str;
+	const char *start = NULL;
+	int startX = 0;
+	size_t bytes = 0;
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+
+	while (*str) {
+		wchar_t wc;
+		size_t len = mbrtowc(&wc, str, MB_CUR_MAX, &state);
+		if (len == (size_t) -1 || len == (size_t) -2 || len == 0) break;
+
+		int cw = wcwidth(wc);
+		if (cw < 0) cw = 0;
+		if (x + cw > maxX) break;
+		if (x >= 0) {
+			if (!start) {
+				start = str;
+				startX = x;
+			}
+			bytes += len;
+		}
+		x += cw;
+		str += len;
+	}
+	if (!start) return;
+
+	wattrset(win, COLOR_PAIR(stroke->color) | (stroke->bold ? A_BOLD : 0));
+	mvwaddnstr(win, y, startX, start, (int) bytes);
+	wattrset(win, A_NORMAL);
+}
+
+// draw a whole tree, centered on the trunk and clipped to the window
+void drawTree(WINDOW* win, const struct tree *tree, int index, int forest) {
+	int originY, originX;
+	treeOrigin(win, index, forest, &originY, &originX);
+
+	for (size_t i = 0; i < tree->count; i++)
+		drawStroke(win, &tree->strokes[i], originY, originX);
+}
+
+// growable byte buffer
+struct buffer {
+	char *data;
+	size_t length, capacity;
+};
+
+void bufferAppend(struct buffer *buf, const char *data, size_t length) {
+	if (buf->length + length > buf->capacity) {
+		size_t newCapacity = buf->capacity ? buf->capacity : 256;
+		while (buf->length + length > newCapacity) newCapacity *= 2;
+		char *newData = realloc(buf->data, newCapacity);
+		if (!newData) return;
+		buf->data = newData;
+		buf->capacity = newCapacity;
+	}
+	memcpy(buf->data + buf->length, data, length);
+	buf->length += length;
+}
+
+void bufferPrint(struct buffer *buf, const char *str) {
+	bufferAppend(buf, str, strlen(str));
+}
+
+// one screen cell of the canvas
+struct cell {
+	char str[8];		// UTF-8 of the character, "" if blank
+	unsigned char width;	// columns it covers, 0 for the right half of a wide one
+	unsigned char color;	// color pair, 0 for none
+	unsigned char bold;
+};
+
+// a rectangle of cells at a place on the screen, the canvas version of a
+// window; it hides whatever is beneath it, like a panel
+struct layer {
+	int y, x;
+	int height, width;
+	struct cell *cells;	// NULL if the layer isn't used
+	struct canvas *canvas;
+};
+
+// the screen as cells, composed from the same layers as the panels: tree at
+// the bottom, then the bases, the message border and the message on top
+struct canvas {
+	int rows, cols;
+	int colors;		// colors the terminal has, as COLORS would say
+	struct layer tree;
+	struct layer base[MAX_FOREST];
+	struct layer messageBorder;
+	struct layer message;
+
+	struct cell *shown;		// what the terminal shows, NULL before the first frame
+	int *dirtyFrom, *dirtyTo;	// columns changed per row, from > to if none
+};
+
+void canvasMarkDirty(struct canvas *canvas, int y, int x0, int x1) {
+	if (!canvas || y < 0 || y >= canvas->rows) return;
+	if (x0 < 0) x0 = 0;
+	if (x1 > canvas->cols - 1) x1 = canvas->cols - 1;
+	if (x0 > x1) return;
+	if (x0 < canvas->dirtyFrom[y]) canvas->dirtyFrom[y] = x0;
+	if (x1 > canvas->dirtyTo[y]) canvas->dirtyTo[y] = x1;
+}
+
+void layerFree(struct layer *layer) {
+	if (layer->cells) {
+		for (int row = 0; row < layer->height; row++)
+			canvasMarkDirty(layer->canvas, layer->y + row, layer->x, layer->x + layer->width - 1);
+	}
+	free(layer->cells);
+	memset(layer, 0, sizeof(*layer));
+}
+
+int layerInit(struct canvas *canvas, struct layer *layer, int height, int width, int y, int x) {
+	layerFree(layer);
+	if (height <= 0 || width <= 0) return 1;
+
+	layer->cells = calloc((size_t) height * width, sizeof(*layer->cells));
+	if (!layer->cells) return 1;
+	for (int i = 0; i < height * width; i++) layer->cells[i].width = 1;
+
+	layer->y = y;
+	layer->x = x;
+	layer->height = height;
+	layer->width = width;
+	layer->canvas = canvas;
+	for (int row = 0; row < height; row++)
+		canvasMarkDirty(canvas, y + row, x, x + width - 1);
+	return 0;
+}
+
+// put one character at a cell of a layer
+void layerPut(struct layer *layer, int y, int x, const char *str, size_t length, int width, unsigned char color, unsigned char bold) {
+	if (y < 0 || y >= layer->height || x < 0 || x + width > layer->width) return;
+	if (length >= sizeof(layer->cells->str)) return;
+
+	struct cell *row = &layer->cells[y * layer->width];
+	struct cell *cell = &row[x];
+
+	// a wide character partly overwritten is erased whole, as curses does
+	int from = x, to = x + width;
+	while (from > 0 && row[from].width == 0) from--;
+	while (to < layer->width && row[to].width == 0) to++;
+	for (int i = from; i < to; i++) {
+		row[i].str[0] = '\0';
+		row[i].width = 1;
+	}
+
+	memcpy(cell->str, str, length);
+	cell->str[length] = '\0';
+	cell->width = (unsigned char) width;
+	cell->color = color;
+	cell->bold = bold;
+	for (int i = 1; i < width; i++) {
+		cell[i].str[0] = '\0';
+		cell[i].width = 0;
+		cell[i].color = color;
+		cell[i].bold = bold;
+	}
+	canvasMarkDirty(layer->canvas, layer->y + y, layer->x + from, layer->x + to - 1);
+}
+
+// the canvas version of drawStroke
+void layerStroke(struct layer *layer, const struct stroke *stroke, int originY, int originX) {
+	int y = originY + stroke->y;
+	int x = originX + stroke->x;
+	if (y < 0 || y >= layer->height || x >= layer->width || x + stroke->width <= 0) return;
+
+	const char *str = stroke->str;
+	if (stroke->ascii) {
+		for (int i = x < 0 ? -x : 0; i < stroke->width && x + i < layer->width; i++)
+			layerPut(layer, y, x + i, str + i, 1, 1, stroke->color, stroke->bold);
+		return;
+	}
+
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+
+	while (*str) {
+		wchar_t wc;
+		size_t len = mbrtowc(&wc, str, MB_CUR_MAX, &state);
+		if (len == (size_t) -1 || len == (size_t) -2 || len == 0) break;
+
+		int cw = wcwidth(wc);
+		if (cw < 0) cw = 0;
+		if (x + cw > layer->width) break;
+		if (x >= 0 && cw > 0) layerPut(layer, y, x, str, len, cw, stroke->color, stroke->bold);
+		x += cw;
+		str += len;
+	}
+}
+
+void canvasFree(struct canvas *canvas) {
+	layerFree(&canvas->tree);
+	for (int i = 0; i < MAX_FOREST; i++) layerFree(&canvas->base[i]);
+	layerFree(&canvas->messageBorder);
+	layerFree(&canvas->message);
+	free(canvas->shown);
+	free(canvas->dirtyFrom);
+	free(canvas->dirtyTo);
+	memset(canvas, 0, sizeof(*canvas));
+}
+
+// start over with an empty screen of the given size
+int canvasInit(struct canvas *canvas, int rows, int cols) {
+	int colors = canvas->colors;
+	canvasFree(canvas);
+	canvas->colors = colors;
+	canvas->rows = rows;
+	canvas->cols = cols;
+	canvas->dirtyFrom = malloc(rows * sizeof(int));
+	canvas->dirtyTo = malloc(rows * sizeof(int));
+	if (!canvas->dirtyFrom || !canvas->dirtyTo) return 1;
+	for (int y = 0; y < rows; y++) {
+		canvas->dirtyFrom[y] = 0;
+		canvas->dirtyTo[y] = cols - 1;
+	}
+	return 0;
+}
+
+// the cell showing at a screen position: the topmost layer covering it wins
+const struct cell* canvasCell(const struct canvas *canvas, int y, int x) {
+	static const struct cell blank = { "", 1, 0, 0 };
+	const struct layer *layers[MAX_FOREST + 3];
+	int count = 0;
+
+	layers[count++] = &canvas->message;
+	layers[count++] = &canvas->messageBorder;
+	for (int i = MAX_FOREST - 1; i >= 0; i--) layers[count++] = &canvas->base[i];
+	layers[count++] = &canvas->tree;
+
+	for (int i = 0; i < count; i++) {
+		const struct layer *layer = layers[i];
+		if (layer->cells && y >= layer->y && y < layer->y + layer->height &&
+				x >= layer->x && x < layer->x + layer->width)
+			return &layer->cells[(y - layer->y) * layer->width + (x - layer->x)];
+	}
+	return &blank;
+}
+
+// the cell as the terminal can show it: halves of a wide character cut
+// apart where one layer meets another show as blanks
+struct cell canvasVisible(const struct canvas *canvas, int y, int x) {
+	static const struct cell blank = { "", 1, 0, 0 };
+	struct cell cell = *canvasCell(canvas, y, x);
+
+	if (cell.width == 0 && (x == 0 || canvasCell(canvas, y, x - 1)->width != 2)) return blank;
+	if (cell.width > 1 && (x + cell.width > canvas->cols || canvasCell(canvas, y, x + 1)->width != 0)) return blank;
+	return cell;
+}
+
+// the color a pair shows in, the way init() sets the pairs up
+int canvasColor(const struct canvas *canvas, int pair, int isNoir) {
+	if (isNoir) return 0;
+	// gray looks white and the bright colors plain where there are only 8
+	if (canvas->colors < 256 && pair >= 8) return pair == 8 ? 7 : pair - 8;
+	return pair;
+}
+
+// the SGR printstdscr uses for a cell's attributes
+void appendSGR(struct buffer *buf, int color, int bold) {
+	char seq[32];
+	if (color > 0)
+		snprintf(seq, sizeof(seq), "\033[0%s;%dm", bold ? ";1" : "", color <= 7 ? 30 + color : 90 + color - 8);
+	else
+		snprintf(seq, sizeof(seq), "\033[0%sm", bold ? ";1" : "");
+	bufferPrint(buf, seq);
+}
+
+// append what turns the terminal's screen into the canvas: only changed
+// cells, with a cursor move only where they aren't adjacent and attributes
+// only where they change
+void canvasRender(struct canvas *canvas, int isNoir, struct buffer *out) {
+	if (!canvas->shown) {
+		canvas->shown = calloc((size_t) canvas->rows * canvas->cols, sizeof(*canvas->shown));
+		if (!canvas->shown) return;
+		bufferPrint(out, "\033[0m\033[H\033[2J");
+		for (int i = 0; i < canvas->rows * canvas->cols; i++) canvas->shown[i].width = 1;
+	}
+
+	int cursorY = -1, cursorX = -1;
+	int color = -1, bold = -1;
+	char seq[32];
+
+	for (int y = 0; y < canvas->rows; y++) {
+		int dirtyTo = canvas->dirtyTo[y];
+		for (int x = canvas->dirtyFrom[y]; x <= dirtyTo; x++) {
+			struct cell cell = canvasVisible(canvas, y, x);
+			struct cell *shown = &canvas->shown[y * canvas->cols + x];
+			cell.color = (unsigned char) canvasColor(canvas, cell.color, isNoir);
+			if (cell.width == 0) continue;
+			if (strcmp(cell.str, shown->str) == 0 && cell.width == shown->width &&
+					cell.color == shown->color && cell.bold == shown->bold)
+				continue;
+
+			if (y != cursorY || x != cursorX) {
+				snprintf(seq, sizeof(seq), "\033[%d;%dH", y + 1, x + 1);
+				bufferPrint(out, seq);
+			}
+			if (cell.color != color || cell.bold != bold) {
+				appendSGR(out, cell.color, cell.bold);
+				color = cell.color;
+				bold = cell.bold;
+			}
+			bufferPrint(out, cell.str[0] ? cell.str : " ");
+
+			// the terminal blanks what's left of a wide character
+			// written over in part, so that is redrawn too
+			int redrawFrom = x;
+			if (shown->width == 0) {
+				while (redrawFrom > 0 && shown[redrawFrom - x].width == 0) redrawFrom--;
+				for (int i = redrawFrom; i < x; i++) {
+					shown[i - x].str[0] = '\0';
+					shown[i - x].width = 1;
+				}
+			}
+			for (int i = x + cell.width; i < canvas->cols && shown[i - x].width == 0; i++) {
+				shown[i - x].str[0] = '\0';
+				shown[i - x].width = 1;
+				if (i > dirtyTo) dirtyTo = i;
+			}
+
+			*shown = cell;
+			for (int i = 1; i < cell.width; i++) {
+				shown[i].str[0] = '\0';
+				shown[i].width = 0;
+			}
+			cursorY = y;
+			cursorX = x + cell.width;
+			if (redrawFrom < x) x = redrawFrom - 1;
+		}
+		canvas->dirtyFrom[y] = canvas->cols;
+		canvas->dirtyTo[y] = -1;
+	}
+}
+
 // based on type of tree, determine what color a branch should be
-void chooseColor(enum branchType type, WINDOW* treeWin, int isNior) {
+void chooseColor(struct rng *rng, enum branchType type, int isNior, struct stroke *stroke) {
 	if (isNior) {
 		// black + white
+		stroke->color = 0;
 		switch(type) {
 			case trunk:
 			case shootLeft:
 			case shootRight:
-				if (rand() % 2 == 0) wattron(treeWin, A_BOLD);
-				else wattron(treeWin, 0);
+				stroke->bold = (rngInt(rng, 2) == 0);
 				break;
-		
+
 			case dying:
-				if (rand() % 10 == 0) wattron(treeWin, A_BOLD);
-				else wattron(treeWin, 0);
+				stroke->bold = (rngInt(rng, 10) == 0);
 				break;
-		
+
 			case dead:
-				if (rand() % 3 == 0) wattron(treeWin, A_BOLD);
-				else wattron(treeWin, 0);
+				stroke->bold = (rngInt(rng, 3) == 0);
 				break;
 			}
 	} else {
@@ -441,134 +1375,83 @@ void chooseColor(enum branchType type, WINDOW* treeWin, int isNior) {
 			case trunk:
 			case shootLeft:
 			case shootRight:
-				if (rand() % 2 == 0) wattron(treeWin, A_BOLD | COLOR_PAIR(11));
-				else wattron(treeWin, COLOR_PAIR(3));
+				stroke->bold = (rngInt(rng, 2) == 0);
+				stroke->color = stroke->bold ? 11 : 3;
 				break;
-		
+
 			case dying:
-				if (rand() % 10 == 0) wattron(treeWin, A_BOLD | COLOR_PAIR(2));
-				else wattron(treeWin, COLOR_PAIR(2));
+				stroke->bold = (rngInt(rng, 10) == 0);
+				stroke->color = 2;
 				break;
-		
+
 			case dead:
-				if (rand() % 3 == 0) wattron(treeWin, A_BOLD | COLOR_PAIR(10));
-				else wattron(treeWin, COLOR_PAIR(10));
+				stroke->bold = (rngInt(rng, 3) == 0);
+				stroke->color = 10;
 				break;
 			}
 	}
 }
 
 // determine change in X and Y coordinates of a given branch
-void setDeltas(enum branchType type, int life, int age, int multiplier, int baseType, int *returnDx, int *returnDy) {
-	int dx = 0;
-	int dy = 0;
-	int dice;
+// a kernel of growth: each step takes a dy and a dx, independently, every
+// entry of a list being as likely as any other; one draw picks both
+struct kernel {
+	int dyCount, dxCount;
+	signed char dy[10];
+	signed char dx[15];
+};
+
+// trunks over upright bases: wandering sideways while young or short lived,
+// then climbing every few steps, then mostly climbing
+const struct kernel trunkYoung = { 1, 3, { 0 }, { -1, 0, 1 } };
+const struct kernel trunkClimb = { 1, 10, { -1 }, { -2, -1, -1, -1, 0, 0, 1, 1, 1, 2 } };
+const struct kernel trunkLevel = { 1, 10, { 0 }, { -2, -1, -1, -1, 0, 0, 1, 1, 1, 2 } };
+const struct kernel trunkMature = { 10, 3, { 0, 0, 0, -1, -1, -1, -1, -1, -1, -1 }, { -1, 0, 1 } };
+
+// trunks out of a mound: straight at the foot, then half climbing and half
+// spreading, swaying further the older they get
+const struct kernel rootedFoot = { 1, 1, { -1 }, { 0 } };
+const struct kernel rootedSway = { 10, 10, { -1, -1, -1, -1, -1, 0, 0, 0, 0, 0 }, { -1, -1, -1, 0, 0, 0, 0, 0, 1, 1 } };
+const struct kernel rootedSpread = { 10, 10, { -1, -1, -1, -1, -1, 0, 0, 0, 0, 0 }, { -1, -1, -1, -1, 0, 0, 0, 1, 1, 1 } };
+
+// shoots trend to their side with little vertical movement
+const struct kernel shootLeftKernel = { 10, 10, { -1, -1, 0, 0, 0, 0, 0, 0, 1, 1 }, { -2, -2, -1, -1, -1, -1, 0, 0, 0, 1 } };
+const struct kernel shootRightKernel = { 10, 10, { -1, -1, 0, 0, 0, 0, 0, 0, 1, 1 }, { 2, 2, 1, 1, 1, 1, 0, 0, 0, -1 } };
+
+// dying branches discourage vertical growth and trend left/right (-3,3)
+const struct kernel dyingKernel = { 10, 15, { -1, -1, 0, 0, 0, 0, 0, 0, 0, 1 }, { -3, -2, -2, -1, -1, -1, 0, 0, 0, 1, 1, 1, 2, 2, 3 } };
+
+// dead branches fill in the surrounding area
+const struct kernel deadKernel = { 10, 3, { -1, -1, -1, 0, 0, 0, 0, 1, 1, 1 }, { -1, 0, 1 } };
+
+void setDeltas(struct rng *rng, enum branchType type, int life, int age, int multiplier, int baseType, int *returnDx, int *returnDy) {
+	const struct kernel *kernel = &deadKernel;
 	switch (type) {
-	case trunk: // trunk
-		if (baseType == 3) {
-			// Base 3: organic curved trunk, not too tall
-			// Mix of upward and horizontal growth
-			roll(&dice, 10);
-			if (dice <= 4) dy = -1;  // 50% go up
-			else dy = 0;  // 50% stay level (spread out)
-
-			// Add natural curve - more sway as it grows
-			if (age <= 3) {
-				dx = 0;  // start straight at base
-				dy = -1; // always go up at base
-			} else if (age <= 10) {
-				roll(&dice, 10);
-				if (dice <= 2) dx = -1;
-				else if (dice >= 8) dx = 1;
-				else dx = 0;
-			} else {
-				roll(&dice, 10);
-				if (dice <= 3) dx = -1;
-				else if (dice >= 7) dx = 1;
-				else dx = 0;
-			}
+	case trunk:
+		if (baseArts[baseType].trunk == trunkRooted) {
+			kernel = age <= 3 ? &rootedFoot : age <= 10 ? &rootedSway : &rootedSpread;
+		} else if (age <= 2 || life < 4) {
+			kernel = &trunkYoung;
+		} else if (age < (multiplier * 3)) {
+			int climbEvery = (int) (multiplier * 0.5);
+			if (climbEvery < 1) climbEvery = 1;
+			kernel = age % climbEvery == 0 ? &trunkClimb : &trunkLevel;
 		} else {
-			// Original behavior for other bases
-			if (age <= 2 || life < 4) {
-				dy = 0;
-				dx = (rand() % 3) - 1;
-			}
-			else if (age < (multiplier * 3)) {
-				if (age % (int) (multiplier * 0.5) == 0) dy = -1;
-				else dy = 0;
-
-				roll(&dice, 10);
-				if (dice >= 0 && dice <=0) dx = -2;
-				else if (dice >= 1 && dice <= 3) dx = -1;
-				else if (dice >= 4 && dice <= 5) dx = 0;
-				else if (dice >= 6 && dice <= 8) dx = 1;
-				else if (dice >= 9 && dice <= 9) dx = 2;
-			}
-			else {
-				roll(&dice, 10);
-				if (dice > 2) dy = -1;
-				else dy = 0;
-				dx = (rand() % 3) - 1;
-			}
+			kernel = &trunkMature;
 		}
 		break;
-
-	case 1: // left shoot: trend left and little vertical movement
-		roll(&dice, 10);
-		if (dice >= 0 && dice <= 1) dy = -1;
-		else if (dice >= 2 && dice <= 7) dy = 0;
-		else if (dice >= 8 && dice <= 9) dy = 1;
-
-		roll(&dice, 10);
-		if (dice >= 0 && dice <=1) dx = -2;
-		else if (dice >= 2 && dice <= 5) dx = -1;
-		else if (dice >= 6 && dice <= 8) dx = 0;
-		else if (dice >= 9 && dice <= 9) dx = 1;
-		break;
-
-	case 2: // right shoot: trend right and little vertical movement
-		roll(&dice, 10);
-		if (dice >= 0 && dice <= 1) dy = -1;
-		else if (dice >= 2 && dice <= 7) dy = 0;
-		else if (dice >= 8 && dice <= 9) dy = 1;
-
-		roll(&dice, 10);
-		if (dice >= 0 && dice <=1) dx = 2;
-		else if (dice >= 2 && dice <= 5) dx = 1;
-		else if (dice >= 6 && dice <= 8) dx = 0;
-		else if (dice >= 9 && dice <= 9) dx = -1;
-		break;
-
-	case 3: // dying: discourage vertical growth(?); trend left/right (-3,3)
-		roll(&dice, 10);
-		if (dice >= 0 && dice <=1) dy = -1;
-		else if (dice >= 2 && dice <=8) dy = 0;
-		else if (dice >= 9 && dice <=9) dy = 1;
-
-		roll(&dice, 15);
-		if (dice >= 0 && dice <=0) dx = -3;
-		else if (dice >= 1 && dice <= 2) dx = -2;
-		else if (dice >= 3 && dice <= 5) dx = -1;
-		else if (dice >= 6 && dice <= 8) dx = 0;
-		else if (dice >= 9 && dice <= 11) dx = 1;
-		else if (dice >= 12 && dice <= 13) dx = 2;
-		else if (dice >= 14 && dice <= 14) dx = 3;
-		break;
-
-	case 4: // dead: fill in surrounding area
-		roll(&dice, 10);
-		if (dice >= 0 && dice <= 2) dy = -1;
-		else if (dice >= 3 && dice <= 6) dy = 0;
-		else if (dice >= 7 && dice <= 9) dy = 1;
-		dx = (rand() % 3) - 1;
-		break;
+	case shootLeft: kernel = &shootLeftKernel; break;
+	case shootRight: kernel = &shootRightKernel; break;
+	case dying: kernel = &dyingKernel; break;
+	case dead: kernel = &deadKernel; break;
 	}
 
-	*returnDx = dx;
-	*returnDy = dy;
+	int draw = rngInt(rng, kernel->dyCount * kernel->dxCount);
+	*returnDy = kernel->dy[draw / kernel->dxCount];
+	*returnDx = kernel->dx[draw % kernel->dxCount];
 }
 
-char* chooseString(const struct config *conf, enum branchType type, int life, int dx, int dy) {
+char* chooseString(const struct config *conf, struct rng *rng, enum branchType type, int life, int dx, int dy) {
 	char* branchStr;
 
 	const unsigned int maxStrLen = 32;
@@ -624,7 +1507,7 @@ char* chooseString(const struct config *conf, enum branchType type, int life, in
 			strcpy(branchStr, "-=:.");
 			break;
 		case dead:
-			strncpy(branchStr, conf->leaves[rand() % conf->leavesSize], maxStrLen - 1);
+			strncpy(branchStr, conf->leaves[rngInt(rng, conf->leavesSize)], maxStrLen - 1);
 			branchStr[maxStrLen - 1] = '\0';
 		}
 	} else {
@@ -652,7 +1535,7 @@ char* chooseString(const struct config *conf, enum branchType type, int life, in
 			break;
 		case dying:
 		case dead:
-			strncpy(branchStr, conf->leaves[rand() % conf->leavesSize], maxStrLen - 1);
+			strncpy(branchStr, conf->leaves[rngInt(rng, conf->leavesSize)], maxStrLen - 1);
 			branchStr[maxStrLen - 1] = '\0';
 		}
 	}
@@ -660,134 +1543,1150 @@ char* chooseString(const struct config *conf, enum branchType type, int life, in
 	return branchStr;
 }
 
-void branch(struct config *conf, struct ncursesObjects *objects, struct counters *myCounters, int y, int x, enum branchType type, int life) {
+// what a branch is being grown into
+struct growth {
+	struct config *conf;
+	struct counters *counters;
+	struct tree *tree;
+	struct taskPool *pool;
+	struct growTask *task;
+};
+
+// a trunk or shoot grown on its own; its strokes are spliced back into the
+// tree in the order a single-threaded recursive walk would have drawn them
+struct growTask {
+	struct rng rng;
+	int y, x;
+	enum branchType type;
+	int life;
+	long long budget;
+
+	struct tree tree;
+	struct splice {
+		size_t at;	// the child task goes before this stroke
+		size_t task;
+	} *splices;
+	size_t spliceCount, spliceCapacity;
+	struct counters counters;
+};
+
+struct taskPool {
+	struct config *conf;
+	struct growTask **tasks;
+	size_t count, capacity;
+	size_t next;	// first task nobody has started yet
+	size_t done;
+#ifndef _WIN32
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+#endif
+};
+
+#define UNLIMITED LLONG_MAX
+
+void spawn(struct growth *g, const struct rng *rng, int step, int y, int x, enum branchType type, int life, int parentLife, long long *budget);
+
+// whether drawing a stroke would change nothing: every cell it covers already
+// shows the same glyph, color and boldness, drawn by a stroke of its type.
+// Ascii strokes are compared a column at a time; others only match the same
+// string drawn at the same place, so no wide character is cut in half
+int strokeRepaints(const struct tree *tree, const struct stroke *stroke) {
+	if (stroke->width <= 0) return 0;
+	for (int i = 0; i < stroke->width; i++) {
+		const struct gridCell *cell = gridCellAt(&tree->occupancy, stroke->y, stroke->x + i);
+		if (!cell || cell->type != stroke->type + 1) return 0;
+
+		const struct stroke *shown = &tree->strokes[cell->stroke];
+		if (shown->color != stroke->color || shown->bold != stroke->bold) return 0;
+		if (shown->ascii && stroke->ascii) {
+			if (shown->str[cell->column] != stroke->str[i]) return 0;
+		} else if (cell->column != i || shown->x != stroke->x || strcmp(shown->str, stroke->str) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// add a grown stroke to the tree, unless --skip-overdraw leaves out one that
+// would repaint what's there already; returns the stored stroke
+const struct stroke* plantStroke(const struct config *conf, struct tree *tree, const struct stroke *stroke, struct counters *myCounters) {
+	if (conf->skipOverdraw && strokeRepaints(tree, stroke)) {
+		myCounters->skipped++;
+		return NULL;
+	}
+
+	const struct stroke *added = treeAdd(tree, stroke);
+	if (added) gridMark(&tree->occupancy, stroke, (unsigned int) (added - tree->strokes), myCounters);
+	return added;
+}
+
+void branch(struct growth *g, struct rng rng, int y, int x, enum branchType type, int life, long long budget) {
+	struct config *conf = g->conf;
+	struct counters *myCounters = g->counters;
 	myCounters->branches++;
 	int dx = 0;
 	int dy = 0;
 	int age = 0;
+	int step = 0;
 	int shootCooldown = conf->multiplier;
+	int shootCounter = rngInt(&rng, 2);	// first shoot is randomly directed
 
 	while (life > 0) {
-		if (checkKeyPress(conf, myCounters) == 1)
-			quit(conf, objects, 0);
+		// every step draws from its own slice of the stream
+		step++;
+		rng.counter = (uint64_t) step * STEP_DRAWS;
+		myCounters->steps++;
+
+		// once this branch's share of the step budget is spent, trunks and
+		// shoots wither into short leaf clusters
+		if (budget != UNLIMITED && budget-- <= 0 && type != dying && type != dead) {
+			type = dying;
+			if (life > 3) life = 3;
+		}
 
 		life--;		// decrement remaining life counter
 		age = conf->lifeStart - life;
 
-		setDeltas(type, life, age, conf->multiplier, conf->baseType, &dx, &dy);
+		setDeltas(&rng, type, life, age, conf->multiplier, conf->baseType, &dx, &dy);
 
-		int maxY = getmaxy(objects->treeWin);
-		if (dy > 0 && y > (maxY - 2)) dy--; // reduce dy if too close to the ground
+		if (dy > 0 && y > -1) dy--; // reduce dy if too close to the ground
 
 		// near-dead branch should branch into a lot of leaves
 		if (life < 3)
-			branch(conf, objects, myCounters, y, x, dead, life);
+			spawn(g, &rng, step, y, x, dead, life, life, &budget);
 
 		// dying trunk should branch into a lot of leaves
 		else if (type == 0 && life < (conf->multiplier + 2))
-			branch(conf, objects, myCounters, y, x, dying, life);
+			spawn(g, &rng, step, y, x, dying, life, life, &budget);
 
 		// dying shoot should branch into a lot of leaves
 		else if ((type == shootLeft || type == shootRight) && life < (conf->multiplier + 2))
-			branch(conf, objects, myCounters, y, x, dying, life);
+			spawn(g, &rng, step, y, x, dying, life, life, &budget);
 
 		// trunks should re-branch if not close to ground AND either randomly, or upon every <multiplier> steps
 		/* else if (type == 0 && ( \ */
 		/* 		(rand() % (conf.multiplier)) == 0 || \ */
 		/* 		(life > conf.multiplier && life % conf.multiplier == 0) */
 		/* 		) ) { */
-		else if (type == trunk && (((rand() % 3) == 0) || (life % conf->multiplier == 0))) {
+		else if (type == trunk && ((rngInt(&rng, 3) == 0) || (life % conf->multiplier == 0))) {
+
+			// if trunk is branching and not about to die, create another trunk with random life
+			if ((rngInt(&rng, 8) == 0) && life > 7) {
+				shootCooldown = conf->multiplier * 2;	// reset shoot cooldown
+				spawn(g, &rng, step, y, x, trunk, life + (rngInt(&rng, 5) - 2), life, &budget);
+			}
+
+			// otherwise create a shoot
+			else if (shootCooldown <= 0) {
+				shootCooldown = conf->multiplier * 2;	// reset shoot cooldown
+
+				int shootLife = (life + conf->multiplier);
+
+				// later shoots alternate sides
+				myCounters->shoots++;
+				shootCounter++;
+
+				// create shoot
+				spawn(g, &rng, step, y, x, (shootCounter % 2) + 1, shootLife, life, &budget);
+			}
+		}
+		shootCooldown--;
+
+		// move in x and y directions
+		x += dx;
+		y += dy;
+
+		struct stroke stroke = { .y = y, .x = x, .branch = myCounters->branches, .type = (unsigned char) type };
+		chooseColor(&rng, type, conf->nior, &stroke);
+
+		// choose string to use for this branch
+		char *branchStr = chooseString(conf, &rng, type, life, dx, dy);
+		strncpy(stroke.str, branchStr, sizeof(stroke.str) - 1);
+		stroke.str[sizeof(stroke.str) - 1] = '\0';
+		free(branchStr);
+
+		// branch strings are ascii, so with ascii leaves every string
+		// is a byte per column and can't overlap a wide character
+		if (conf->asciiLeaves) {
+			stroke.ascii = 1;
+			stroke.width = (int) strlen(stroke.str);
+			treeAdd(g->tree, &stroke);
+			continue;
+		}
+
+		// grab wide character from branchStr
+		wchar_t wc = 0;
+		mbstate_t *ps = 0;
+		mbrtowc(&wc, stroke.str, sizeof(stroke.str), ps);
+
+		// record, but ensure wide characters don't overlap
+		int cw = wcwidth(wc);
+		if (cw == 0 || x % cw == 0) {
+			stroke.width = strWidth(stroke.str);
+
+			// keep every stroke, overdraw is sorted out when merging
+			treeAdd(g->tree, &stroke);
+		}
+	}
+}
+
+// queue a subtree for any thread to grow, returns its index
+size_t taskPush(struct taskPool *pool, struct rng rng, int y, int x, enum branchType type, int life, long long budget) {
+	struct growTask *task = calloc(1, sizeof(*task));
+	if (!task) return SIZE_MAX;
+	task->rng = rng;
+	task->y = y;
+	task->x = x;
+	task->type = type;
+	task->life = life;
+	task->budget = budget;
+
+	size_t index = SIZE_MAX;
+#ifndef _WIN32
+	pthread_mutex_lock(&pool->lock);
+#endif
+	if (pool->count == pool->capacity) {
+		size_t newCapacity = pool->capacity ? pool->capacity * 2 : 64;
+		struct growTask **newTasks = realloc(pool->tasks, newCapacity * sizeof(*newTasks));
+		if (newTasks) {
+			pool->tasks = newTasks;
+			pool->capacity = newCapacity;
+		}
+	}
+	if (pool->count < pool->capacity) {
+		index = pool->count;
+		pool->tasks[pool->count++] = task;
+	}
+#ifndef _WIN32
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+#endif
+
+	if (index == SIZE_MAX) free(task);
+	return index;
+}
+
+// grow a child branch: when growing headless, trunks and shoots become tasks
+// of their own, leaf clusters are small enough to grow in place
+void spawn(struct growth *g, const struct rng *rng, int step, int y, int x, enum branchType type, int life, int parentLife, long long *budget) {
+	struct rng childRng = rngChild(rng, step);
+
+	// room to splice the child in later; without it, it's grown in place
+	struct growTask *task = g->task;
+	int queue = g->pool && (type == trunk || type == shootLeft || type == shootRight);
+	if (queue && task->spliceCount == task->spliceCapacity) {
+		size_t newCapacity = task->spliceCapacity ? task->spliceCapacity * 2 : 8;
+		struct splice *newSplices = realloc(task->splices, newCapacity * sizeof(*newSplices));
+		if (newSplices) {
+			task->splices = newSplices;
+			task->spliceCapacity = newCapacity;
+		} else {
+			queue = 0;
+		}
+	}
+
+	// hand the child a share of the budget proportional to its life
+	long long share = UNLIMITED;
+	if (*budget != UNLIMITED) {
+		share = 0;
+		if (*budget > 0 && life > 0) share = *budget * life / (life + parentLife + 1);
+		*budget -= share;
+	}
+
+	// a queued child's strokes are spliced in where growing it in place
+	// would have put them, so either way the tree comes out the same
+	size_t index = queue ? taskPush(g->pool, childRng, y, x, type, life, share) : SIZE_MAX;
+	if (index != SIZE_MAX) {
+		task->splices[task->spliceCount].at = task->tree.count;
+		task->splices[task->spliceCount].task = index;
+		task->spliceCount++;
+	} else {
+		branch(g, childRng, y, x, type, life, share);
+	}
+}
+
+void taskRun(struct taskPool *pool, struct growTask *task) {
+	struct growth g = { pool->conf, &task->counters, &task->tree, pool, task };
+	branch(&g, task->rng, task->y, task->x, task->type, task->life, task->budget);
+}
+
+// run queued tasks until every task, including the ones they spawn, is grown
+void* taskWorker(void *arg) {
+	struct taskPool *pool = arg;
+
+#ifdef _WIN32
+	while (pool->next < pool->count) {
+		taskRun(pool, pool->tasks[pool->next++]);
+		pool->done++;
+	}
+#else
+	pthread_mutex_lock(&pool->lock);
+	while (1) {
+		while (pool->next == pool->count && pool->done < pool->count)
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		if (pool->done == pool->count) break;
+
+		struct growTask *task = pool->tasks[pool->next++];
+		pthread_mutex_unlock(&pool->lock);
+		taskRun(pool, task);
+		pthread_mutex_lock(&pool->lock);
+
+		pool->done++;
+		pthread_cond_broadcast(&pool->wake);
+	}
+	pthread_mutex_unlock(&pool->lock);
+#endif
+	return NULL;
+}
+
+// splice a task's strokes into the tree in recursive drawing order
+void mergeTask(const struct config *conf, const struct taskPool *pool, size_t index, struct tree *tree, struct counters *myCounters) {
+	const struct growTask *task = pool->tasks[index];
+	size_t splice = 0;
+
+	for (size_t i = 0; i <= task->tree.count; i++) {
+		while (splice < task->spliceCount && task->splices[splice].at == i)
+			mergeTask(conf, pool, task->splices[splice++].task, tree, myCounters);
+		if (i < task->tree.count) {
+			// branches merged so far come before this task's own
+			struct stroke stroke = task->tree.strokes[i];
+			stroke.branch += myCounters->branches;
+			plantStroke(conf, tree, &stroke, myCounters);
+		}
+	}
+
+	myCounters->branches += task->counters.branches;
+	myCounters->shoots += task->counters.shoots;
+	myCounters->steps += task->counters.steps;
+}
+
+// threads to grow on, 0 asks for one per CPU
+int jobCount(const struct config *conf) {
+#ifdef _WIN32
+	(void) conf;
+	return 1;
+#else
+	int jobs = conf->jobs;
+	if (jobs <= 0) jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs < 1) jobs = 1;
+	if (jobs > 64) jobs = 64;
+	return jobs;
+#endif
+}
+
+// grow every tree of a forest without drawing them, spreading subtrees over
+// conf->jobs threads; the result is the same for any number of threads
+void growForest(struct config *conf, struct counters *myCounters, struct tree *trees, int forest) {
+	struct taskPool pool;
+	memset(&pool, 0, sizeof(pool));
+	pool.conf = conf;
+
+#ifndef _WIN32
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.wake, NULL);
+#endif
+
+	// the first tree grows from the seed itself, the others from their own streams
+	long long budget = conf->budget > 0 ? conf->budget : UNLIMITED;
+	size_t roots[MAX_FOREST];
+	for (int i = 0; i < forest; i++) {
+		struct rng rng = { mix64((uint64_t) conf->seed + (uint64_t) i * 0x9e3779b97f4a7c15ULL), 0 };
+		roots[i] = taskPush(&pool, rng, 0, 0, trunk, conf->lifeStart, budget);
+	}
+
+#ifndef _WIN32
+	// the calling thread works too
+	pthread_t threads[64];
+	int started = 0;
+	for (int i = 1; i < jobCount(conf); i++) {
+		if (pthread_create(&threads[started], NULL, taskWorker, &pool) == 0) started++;
+	}
+#endif
+	taskWorker(&pool);
+#ifndef _WIN32
+	for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+	pthread_cond_destroy(&pool.wake);
+	pthread_mutex_destroy(&pool.lock);
+#endif
+
+	// every tree counts its branches from zero, the totals add up
+	struct counters total = *myCounters;
+	for (int i = 0; i < forest; i++) {
+		if (roots[i] == SIZE_MAX) continue;
+		myCounters->branches = myCounters->shoots = myCounters->steps = 0;
+		mergeTask(conf, &pool, roots[i], &trees[i], myCounters);
+		total.branches += myCounters->branches;
+		total.shoots += myCounters->shoots;
+		total.steps += myCounters->steps;
+	}
+	total.cells = myCounters->cells;
+	total.overdraw = myCounters->overdraw;
+	total.skipped = myCounters->skipped;
+	*myCounters = total;
+
+	for (size_t i = 0; i < pool.count; i++) {
+		treeFree(&pool.tasks[i]->tree);
+		free(pool.tasks[i]->splices);
+		free(pool.tasks[i]);
+	}
+	free(pool.tasks);
+}
+
+// reset the counters and grow a forest from scratch, no terminal needed
+void growTrees(struct config *conf, struct counters *myCounters, struct tree *trees, int forest) {
+	myCounters->shoots = 0;
+	myCounters->branches = 0;
+	myCounters->steps = 0;
+	myCounters->cells = 0;
+	myCounters->overdraw = 0;
+	myCounters->skipped = 0;
+	myCounters->dropped = 0;
+	for (int i = 0; i < forest; i++) treeReset(&trees[i]);
+
+	growForest(conf, myCounters, trees, forest);
+}
+
+// what --search measures on a grown tree
+enum scoreField {scoreHeight, scoreWidth, scoreCells, scoreLeaves, scoreSymmetry, scoreBranches, SCORE_FIELDS};
+const char *scoreNames[SCORE_FIELDS] = {"height", "width", "cells", "leaves", "symmetry", "branches"};
+
+struct score {
+	int seed;
+	int field[SCORE_FIELDS];
+};
+
+// one "name<op>value" term of a search filter
+struct constraint {
+	int field;
+	char op;	// '<', '>', '=', '!', 'l' (<=) or 'g' (>=)
+	int value;
+};
+
+#define MAX_CONSTRAINTS 16
+
+struct search {
+	struct config *conf;
+	struct constraint constraints[MAX_CONSTRAINTS];
+	int constraintCount;
+
+	long long next, end;	// seeds still to grow
+	struct score *matches;
+	size_t matchCount, matchCapacity;
+#ifndef _WIN32
+	pthread_mutex_t lock;
+#endif
+};
+
+// parse a filter like "height>=20,width<=60", returns 1 on error
+int parseFilter(char *filter, struct search *search) {
+	search->constraintCount = 0;
+
+	for (char *term = strtok(filter, ","); term; term = strtok(NULL, ",")) {
+		if (search->constraintCount == MAX_CONSTRAINTS) return 1;
+		struct constraint *c = &search->constraints[search->constraintCount];
+
+		size_t nameLength = strcspn(term, "<>=!");
+		c->field = -1;
+		for (int i = 0; i < SCORE_FIELDS; i++) {
+			if (strlen(scoreNames[i]) == nameLength && strncmp(term, scoreNames[i], nameLength) == 0)
+				c->field = i;
+		}
+		if (c->field < 0) return 1;
+
+		char *op = term + nameLength;
+		char *value = op + 1;
+		if (op[0] == '<' && op[1] == '=') { c->op = 'l'; value++; }
+		else if (op[0] == '>' && op[1] == '=') { c->op = 'g'; value++; }
+		else if (op[0] == '!' && op[1] == '=') { c->op = '!'; value++; }
+		else if (op[0] == '<' || op[0] == '>' || op[0] == '=') c->op = op[0];
+		else return 1;
+
+		char *end;
+		errno = 0;
+		long v = strtol(value, &end, 10);
+		if (errno || end == value || *end != '\0' || v < INT_MIN || v > INT_MAX) return 1;
+		c->value = (int) v;
+
+		search->constraintCount++;
+	}
+	return 0;
+}
+
+int scoreMatches(const struct search *search, const struct score *score) {
+	for (int i = 0; i < search->constraintCount; i++) {
+		const struct constraint *c = &search->constraints[i];
+		int v = score->field[c->field];
+		switch (c->op) {
+		case '<': if (!(v < c->value)) return 0; break;
+		case '>': if (!(v > c->value)) return 0; break;
+		case '=': if (!(v == c->value)) return 0; break;
+		case '!': if (!(v != c->value)) return 0; break;
+		case 'l': if (!(v <= c->value)) return 0; break;
+		case 'g': if (!(v >= c->value)) return 0; break;
+		}
+	}
+	return 1;
+}
+
+// measure a grown tree: size, how much of it is leaves, and how well its
+// left side mirrors its right about the trunk (both in percent of cells)
+void scoreTree(const struct tree *tree, const struct counters *myCounters, struct score *score) {
+	int leafCells = 0, mirrored = 0;
+	for (int y = tree->minY; y <= tree->maxY; y++) {
+		for (int x = tree->minX; x <= tree->maxX; x++) {
+			int cell = gridGet(&tree->occupancy, y, x);
+			if (!cell) continue;
+			if (cell > dying) leafCells++;
+			if (gridGet(&tree->occupancy, y, -x)) mirrored++;
+		}
+	}
+
+	score->field[scoreHeight] = tree->maxY - tree->minY + 1;
+	score->field[scoreWidth] = tree->maxX - tree->minX + 1;
+	score->field[scoreCells] = myCounters->cells;
+	score->field[scoreLeaves] = myCounters->cells ? leafCells * 100 / myCounters->cells : 0;
+	score->field[scoreSymmetry] = myCounters->cells ? mirrored * 100 / myCounters->cells : 0;
+	score->field[scoreBranches] = myCounters->branches;
+}
+
+// grow seeds in batches until the range is used up
+void* searchWorker(void *arg) {
+	struct search *search = arg;
+
+	// every worker grows its trees alone, the search itself is the parallel part
+	struct config conf = *search->conf;
+	conf.jobs = 1;
+
+	struct counters myCounters;
+	struct tree tree;
+	memset(&tree, 0, sizeof(tree));
+
+	while (1) {
+#ifndef _WIN32
+		pthread_mutex_lock(&search->lock);
+#endif
+		long long first = search->next;
+		long long last = first + 64 < search->end ? first + 64 : search->end;
+		search->next = last;
+#ifndef _WIN32
+		pthread_mutex_unlock(&search->lock);
+#endif
+		if (first >= last) break;
+
+		for (long long seed = first; seed < last; seed++) {
+			conf.seed = (int) seed;
+			growTrees(&conf, &myCounters, &tree, 1);
+
+			struct score score = { .seed = conf.seed };
+			scoreTree(&tree, &myCounters, &score);
+			if (!scoreMatches(search, &score)) continue;
+
+#ifndef _WIN32
+			pthread_mutex_lock(&search->lock);
+#endif
+			if (search->matchCount == search->matchCapacity) {
+				size_t newCapacity = search->matchCapacity ? search->matchCapacity * 2 : 64;
+				struct score *newMatches = realloc(search->matches, newCapacity * sizeof(*newMatches));
+				if (newMatches) {
+					search->matches = newMatches;
+					search->matchCapacity = newCapacity;
+				}
+			}
+			if (search->matchCount < search->matchCapacity)
+				search->matches[search->matchCount++] = score;
+#ifndef _WIN32
+			pthread_mutex_unlock(&search->lock);
+#endif
+		}
+	}
+
+	treeFree(&tree);
+	return NULL;
+}
+
+int compareScores(const void *a, const void *b) {
+	int seedA = ((const struct score *) a)->seed;
+	int seedB = ((const struct score *) b)->seed;
+	return (seedA > seedB) - (seedA < seedB);
+}
+
+// grow conf->scan trees starting at conf->seed and print the seeds of the
+// ones that pass the filter, one line of scores each
+int searchSeeds(struct config *conf) {
+	struct search search;
+	memset(&search, 0, sizeof(search));
+	search.conf = conf;
+
+	if (parseFilter(conf->search, &search) != 0) {
+		printf("error: invalid search filter\n");
+		return 1;
+	}
+
+	search.next = conf->seed ? conf->seed : 1;
+	search.end = search.next + conf->scan;
+	if (search.end > (long long) INT_MAX + 1) search.end = (long long) INT_MAX + 1;
+
+#ifndef _WIN32
+	pthread_mutex_init(&search.lock, NULL);
+
+	// the calling thread works too
+	pthread_t threads[64];
+	int started = 0;
+	for (int i = 1; i < jobCount(conf); i++) {
+		if (pthread_create(&threads[started], NULL, searchWorker, &search) == 0) started++;
+	}
+#endif
+	searchWorker(&search);
+#ifndef _WIN32
+	for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&search.lock);
+#endif
+
+	// threads finish out of order, print by seed
+	qsort(search.matches, search.matchCount, sizeof(*search.matches), compareScores);
+
+	printf("seed");
+	for (int i = 0; i < SCORE_FIELDS; i++) printf("\t%s", scoreNames[i]);
+	printf("\n");
+	for (size_t m = 0; m < search.matchCount; m++) {
+		printf("%d", search.matches[m].seed);
+		for (int i = 0; i < SCORE_FIELDS; i++) printf("\t%d", search.matches[m].field[i]);
+		printf("\n");
+	}
+
+	free(search.matches);
+	return 0;
+}
+
+// start an asciicast v2 recording of what reaches the screen
+int startRecording(struct config *conf, int rows, int cols) {
+	conf->recording = fopen(conf->recordFile, "w");
+	if (!conf->recording) {
+		printf("error: file was not opened properly for writing: %s\n", conf->recordFile);
+		return 1;
+	}
+	conf->recordTime = 0;
+
+	fprintf(conf->recording, "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %lld}\n",
+		cols, rows, (long long) time(NULL));
+	return 0;
+}
+
+// append one output event holding buf, JSON-escaped
+void recordEvent(struct config *conf, const struct buffer *buf) {
+	fprintf(conf->recording, "[%.6f, \"o\", \"", conf->recordTime);
+	for (size_t i = 0; i < buf->length; i++) {
+		unsigned char c = (unsigned char) buf->data[i];
+		if (c == '"' || c == '\\') fprintf(conf->recording, "\\%c", c);
+		else if (c == '\n') fputs("\\n", conf->recording);
+		else if (c == '\r') fputs("\\r", conf->recording);
+		else if (c < 0x20 || c == 0x7f) fprintf(conf->recording, "\\u%04x", c);
+		else fputc(c, conf->recording);
+	}
+	fputs("\"]\n", conf->recording);
+}
+
+// the composed screen after update_panels(), whether or not it was sent yet
+#ifdef _WIN32
+#define RECORD_SCREEN curscr
+#else
+#define RECORD_SCREEN newscr
+#endif
+
+// append the ANSI for screen cells x0..x1 of row y, as composed for the terminal
+void recordCells(const struct config *conf, struct buffer *buf, int y, int x0, int x1) {
+	char seq[64];
+	snprintf(seq, sizeof(seq), "\033[%d;%dH", y + 1, x0 + 1);
+	bufferPrint(buf, seq);
+
+	int lastBold = -1, lastFg = -1;
+	for (int x = x0; x <= x1; x++) {
+		int bold, fg, cwidth = 1;
+		char text[64] = "";
+
+#ifdef _WIN32
+		chtype ch = mvwinch(RECORD_SCREEN, y, x);
+		short pairFg = 0, pairBg = 0;
+		pair_content((short) PAIR_NUMBER(ch), &pairFg, &pairBg);
+		bold = (ch & A_BOLD) != 0;
+		fg = pairFg;
+		text[0] = (char) (ch & A_CHARTEXT);
+		text[1] = '\0';
+#else
+		cchar_t c;
+		wchar_t wch[CCHARW_MAX + 1] = {0};
+		attr_t attrs;
+		short colorPair, pairFg = 0, pairBg = 0;
+		mvwin_wch(RECORD_SCREEN, y, x, &c);
+		getcchar(&c, wch, &attrs, &colorPair, 0);
+		pair_content(colorPair, &pairFg, &pairBg);
+		bold = (attrs & A_BOLD) != 0;
+		fg = pairFg;
+
+		mbstate_t state;
+		memset(&state, 0, sizeof(state));
+		size_t length = 0;
+		cwidth = 0;
+		if (wch[0] >= L' ' && wch[0] <= L'~' && wch[1] == 0) {
+			text[length++] = (char) wch[0];
+			cwidth = 1;
+		} else {
+			for (int i = 0; wch[i] && length + MB_LEN_MAX < sizeof(text); i++) {
+				size_t n = wcrtomb(text + length, wch[i], &state);
+				if (n != (size_t) -1) length += n;
+				if (wcwidth(wch[i]) > 0) cwidth += wcwidth(wch[i]);
+			}
+		}
+		text[length] = '\0';
+#endif
+
+		// same colors printstdscr uses, only sent when they change
+		if (conf->nior) fg = 0;
+		if (bold != lastBold || fg != lastFg) {
+			snprintf(seq, sizeof(seq), "\033[0%s", bold ? ";1" : "");
+			bufferPrint(buf, seq);
+			if (fg > 0) {
+				snprintf(seq, sizeof(seq), ";%d", fg <= 7 ? 30 + fg : 90 + fg - 8);
+				bufferPrint(buf, seq);
+			}
+			bufferPrint(buf, "m");
+			lastBold = bold;
+			lastFg = fg;
+		}
+		bufferPrint(buf, text[0] ? text : " ");
+
+		if (cwidth > 1) x += cwidth - 1;
+	}
+}
+
+// record the whole screen, e.g. for the first frame of a tree
+void recordScreen(struct config *conf) {
+	struct buffer buf = { NULL, 0, 0 };
+	bufferPrint(&buf, "\033[?25l\033[0m\033[H\033[2J");
+
+	for (int y = 0; y < LINES; y++) {
+		// only the non-blank part of every row
+		int first = -1, last = -1;
+		for (int x = 0; x < COLS; x++) {
+			if ((mvwinch(RECORD_SCREEN, y, x) & A_CHARTEXT) != ' ') {
+				if (first < 0) first = x;
+				last = x;
+			}
+		}
+		if (first >= 0) recordCells(conf, &buf, y, first, last);
+	}
+
+	recordEvent(conf, &buf);
+	free(buf.data);
+}
+
+void stopRecording(struct config *conf) {
+	if (!conf->recording) return;
+
+	// cursor back, below everything
+	char trailer[] = "\033[0m\033[?25h\033[999;1H\r\n";
+	struct buffer buf = { trailer, strlen(trailer), sizeof(trailer) };
+	recordEvent(conf, &buf);
+
+	fclose(conf->recording);
+	conf->recording = NULL;
+}
+
+// read one JSON string starting at the opening quote, decoded as UTF-8 into
+// buf; returns a pointer past the closing quote, NULL if malformed
+const char* parseJSONString(const char *p, struct buffer *buf) {
+	if (*p++ != '"') return NULL;
+
+	while (*p && *p != '"') {
+		if (*p != '\\') {
+			bufferAppend(buf, p++, 1);
+			continue;
+		}
+
+		p++;
+		char c = *p++;
+		switch (c) {
+		case 'n': bufferPrint(buf, "\n"); break;
+		case 'r': bufferPrint(buf, "\r"); break;
+		case 't': bufferPrint(buf, "\t"); break;
+		case 'b': bufferPrint(buf, "\b"); break;
+		case 'f': bufferPrint(buf, "\f"); break;
+		case 'u': {
+			char hex[5] = {0};
+			unsigned long code;
+			for (int i = 0; i < 4; i++) {
+				if (!isxdigit((unsigned char) p[i])) return NULL;
+				hex[i] = p[i];
+			}
+			code = strtoul(hex, NULL, 16);
+			p += 4;
+
+			// surrogate pair
+			if (code >= 0xd800 && code < 0xdc00 && p[0] == '\\' && p[1] == 'u') {
+				for (int i = 0; i < 4; i++) {
+					if (!isxdigit((unsigned char) p[2 + i])) return NULL;
+					hex[i] = p[2 + i];
+				}
+				unsigned long low = strtoul(hex, NULL, 16);
+				if (low >= 0xdc00 && low < 0xe000) {
+					code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					p += 6;
+				}
+			}
+
+			char utf8[4];
+			size_t n;
+			if (code < 0x80) { utf8[0] = (char) code; n = 1; }
+			else if (code < 0x800) { utf8[0] = (char) (0xc0 | code >> 6); utf8[1] = (char) (0x80 | (code & 0x3f)); n = 2; }
+			else if (code < 0x10000) { utf8[0] = (char) (0xe0 | code >> 12); utf8[1] = (char) (0x80 | ((code >> 6) & 0x3f)); utf8[2] = (char) (0x80 | (code & 0x3f)); n = 3; }
+			else { utf8[0] = (char) (0xf0 | code >> 18); utf8[1] = (char) (0x80 | ((code >> 12) & 0x3f)); utf8[2] = (char) (0x80 | ((code >> 6) & 0x3f)); utf8[3] = (char) (0x80 | (code & 0x3f)); n = 4; }
+			bufferAppend(buf, utf8, n);
+			break;
+		}
+		case '\0': return NULL;
+		default: bufferAppend(buf, &c, 1); break;
+		}
+	}
+
+	return *p == '"' ? p + 1 : NULL;
+}
+
+// play an asciicast v2 recording back to stdout in real time; nothing is
+// grown and no screen is set up, it only reads, sleeps and writes
+int replayRecording(const char *fname) {
+	FILE *fp = fopen(fname, "r");
+	if (!fp) {
+		printf("error: file was not opened properly for reading: %s\n", fname);
+		return 1;
+	}
+
+	struct buffer line = { NULL, 0, 0 };
+	struct buffer output = { NULL, 0, 0 };
+	double start = monotonicTime();
+	int lineNumber = 0, returnCode = 0;
+	char chunk[4096];
+
+	while (1) {
+		// read a whole line, however long
+		line.length = 0;
+		while (fgets(chunk, sizeof(chunk), fp)) {
+			bufferPrint(&line, chunk);
+			if (line.length && line.data[line.length - 1] == '\n') break;
+		}
+		if (line.length == 0) break;
+		bufferAppend(&line, "", 1);
+		lineNumber++;
+
+		// the header and blank lines carry nothing to show
+		const char *p = line.data;
+		while (isspace((unsigned char) *p)) p++;
+		if (*p == '{' || *p == '\0') continue;
+
+		// [time, "o", "data"]
+		char *end;
+		double eventTime = 0;
+		struct buffer type = { NULL, 0, 0 };
+		if (*p == '[') eventTime = strtod(p + 1, &end);
+		if (*p != '[' || end == p + 1 || !(p = strchr(end, '"')) || !(p = parseJSONString(p, &type))) {
+			printf("error: %s:%d: not an asciicast v2 event\n", fname, lineNumber);
+			free(type.data);
+			returnCode = 1;
+			break;
+		}
+		int isOutput = type.length == 1 && type.data[0] == 'o';
+		free(type.data);
+		if (!isOutput) continue;
+
+		// wait for the frame's time, writing everything due before it in one go
+		if (start + eventTime > monotonicTime()) {
+			fwrite(output.data, 1, output.length, stdout);
+			fflush(stdout);
+			output.length = 0;
+			sleepUntil(start + eventTime);
+		}
+
+		if (!(p = strchr(p, '"')) || !parseJSONString(p, &output)) {
+			printf("error: %s:%d: not an asciicast v2 event\n", fname, lineNumber);
+			returnCode = 1;
+			break;
+		}
+	}
+
+	fwrite(output.data, 1, output.length, stdout);
+	fflush(stdout);
+
+	free(line.data);
+	free(output.data);
+	fclose(fp);
+	return returnCode;
+}
+
+void resizeWins(const struct config *conf, struct ncursesObjects *objects, const struct tree *trees, int forest, size_t frames);
+
+// live mode: replay the grown trees stroke by stroke, every tree of the
+// forest taking its next step in the same frame
+void animateForest(struct config *conf, struct ncursesObjects *objects, struct counters *myCounters, const struct tree *trees, int forest) {
+	int originY[MAX_FOREST], originX[MAX_FOREST];
+	size_t frames = 0;
+	for (int i = 0; i < forest; i++) {
+		treeOrigin(objects->treeWin, i, forest, &originY[i], &originX[i]);
+		if (trees[i].count > frames) frames = trees[i].count;
+	}
+
+	int maxY, maxX;
+	getmaxyx(objects->treeWin, maxY, maxX);
+
+	// what gets saved is how far the animation got
+	myCounters->branches = 0;
+
+	// the first frame shown is recorded whole, the rest only where strokes land
+	int recordWhole = 1;
+
+	// frames keep to a fixed schedule; when the terminal can't keep up (it
+	// hasn't answered for recent frames, its output queue is backed up, or
+	// writing to it stalled us past the next frame) frames are merged into
+	// later ones instead of piling up
+	double due = 0;
+	struct terminalProbe probe;
+	probeStart(&probe);
+
+	for (size_t frame = 0; frame < frames; frame++) {
+		// while asking the terminal how far behind it is, curses only gets
+		// to see the keys among the answers
+		int checkKeys = 1;
+		if (probe.active) {
+			unsigned char keys[64];
+			int count = probeRead(&probe, keys, sizeof(keys));
+			for (int i = count - 1; i >= 0; i--) ungetch(keys[i]);
+			checkKeys = count > 0 || !probe.active;
+		}
+		if (checkKeys && checkKeyPress(conf, myCounters) == 1)
+			quit(conf, objects, 0);
+
+		if (terminalResized) {
+			terminalResized = 0;
+			resizeWins(conf, objects, trees, forest, frame);
+			for (int i = 0; i < forest; i++) treeOrigin(objects->treeWin, i, forest, &originY[i], &originX[i]);
+			getmaxyx(objects->treeWin, maxY, maxX);
+			recordWhole = 1;
+		}
+
+		for (int i = 0; i < forest; i++) {
+			if (frame >= trees[i].count) continue;
+
+			const struct stroke *stroke = &trees[i].strokes[frame];
+			drawStroke(objects->treeWin, stroke, originY[i], originX[i]);
+			if (stroke->branch > myCounters->branches) myCounters->branches = stroke->branch;
+		}
+
+		// skip updating if we're still loading from file
+		if (conf->load && myCounters->branches < conf->targetBranchCount) continue;
+
+		if (due == 0) due = monotonicTime();
+		due += conf->timeStep;
+
+		update_panels();
+		if (frame + 1 == frames || (monotonicTime() < due && !probeBehind(&probe) && outputBacklog() <= MAX_BACKLOG)) {
+			doupdate();
+			probeSend(&probe);
+		} else {
+			myCounters->dropped++;
+		}
+		sleepUntil(due);
+
+		if (!conf->recording) continue;
+		if (recordWhole) {
+			recordScreen(conf);
+			recordWhole = 0;
+		} else {
+			struct buffer buf = { NULL, 0, 0 };
+			for (int i = 0; i < forest; i++) {
+				if (frame >= trees[i].count) continue;
+
+				const struct stroke *stroke = &trees[i].strokes[frame];
+				int y = originY[i] + stroke->y;
+				int x0 = originX[i] + stroke->x;
+				int x1 = x0 + stroke->width - 1;
+				if (x0 < 0) x0 = 0;
+				if (x1 > maxX - 1) x1 = maxX - 1;
+				if (y >= 0 && y < maxY && x0 <= x1) recordCells(conf, &buf, y, x0, x1);
+			}
+			if (buf.length) recordEvent(conf, &buf);
+			free(buf.data);
+		}
+		conf->recordTime += conf->timeStep;
+	}
+
+	probeFinish(&probe);
+}
+
+// a message word wrapped to fit its box, one line at a time
+struct messageLine {
+	size_t start, end;	// bytes of the message on the line
+	int width;		// display columns they take up
+};
+
+struct wrappedMessage {
+	const char *message;
+	struct messageLine *lines;
+	int count, capacity;
+	int boxHeight, boxWidth;	// size of the text area; the border goes around it
+};
+
+// end a line of a wrapped message, leaving out any blanks it ends with
+int wrapLine(struct wrappedMessage *wrapped, size_t start, size_t end, int width) {
+	while (end > start && isspace((unsigned char) wrapped->message[end - 1])) {
+		end--;
+		width--;
+	}
 
-			// if trunk is branching and not about to die, create another trunk with random life
-			if ((rand() % 8 == 0) && life > 7) {
-				shootCooldown = conf->multiplier * 2;	// reset shoot cooldown
-				branch(conf, objects, myCounters, y, x, trunk, life + (rand() % 5 - 2));
-			}
+	if (wrapped->count == wrapped->capacity) {
+		int newCapacity = wrapped->capacity ? wrapped->capacity * 2 : 8;
+		struct messageLine *newLines = realloc(wrapped->lines, newCapacity * sizeof(*newLines));
+		if (!newLines) return 1;
+		wrapped->lines = newLines;
+		wrapped->capacity = newCapacity;
+	}
+	wrapped->lines[wrapped->count++] = (struct messageLine) { start, end, width };
 
-			// otherwise create a shoot
-			else if (shootCooldown <= 0) {
-				shootCooldown = conf->multiplier * 2;	// reset shoot cooldown
+	if (width + 1 > wrapped->boxWidth) wrapped->boxWidth = width + 1;
+	wrapped->boxHeight = wrapped->count;
+	return 0;
+}
 
-				int shootLife = (life + conf->multiplier);
+// width of the character a message has at str, and its length in bytes;
+// anything that won't decode takes a column a byte, as curses shows it
+int messageChar(const char *str, mbstate_t *state, size_t *length) {
+	if ((unsigned char) *str < 0x80) {
+		*length = 1;
+		return 1;
+	}
 
-				// first shoot is randomly directed
-				myCounters->shoots++;
-				myCounters->shootCounter++;
-				if (conf->verbosity) mvwprintw(objects->treeWin, 4, 5, "shoots: %02d", myCounters->shoots);
+	wchar_t wc;
+	*length = mbrtowc(&wc, str, MB_CUR_MAX, state);
+	if (*length == (size_t) -1 || *length == (size_t) -2 || *length == 0) {
+		memset(state, 0, sizeof(*state));
+		*length = 1;
+		return 1;
+	}
+	int cw = wcwidth(wc);
+	return cw < 1 ? 1 : cw;
+}
 
-				// create shoot
-				branch(conf, objects, myCounters, y, x, (myCounters->shootCounter % 2) + 1, shootLife);
-			}
+// word wrap a message in a single pass for a screen cols wide, breaking
+// lines at blanks, or mid-word for words longer than a whole line; the box
+// takes up at most a quarter of the screen's width
+int wrapMessage(const char *message, int cols, struct wrappedMessage *wrapped) {
+	memset(wrapped, 0, sizeof(*wrapped));
+	wrapped->message = message;
+	int maxWidth = (int) (0.25 * cols) - 1;
+	if (maxWidth < 1) maxWidth = 1;
+
+	size_t lineStart = 0;
+	int lineWidth = 0;
+
+	// the last run of blanks on the line, where it can break
+	size_t breakStart = 0, breakEnd = 0;
+	int breakWidth = 0, afterBreakWidth = 0;
+	int canBreak = 0;
+
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+
+	size_t i = 0;
+	while (message[i]) {
+		char c = message[i];
+		if (c == '\n') {
+			if (wrapLine(wrapped, lineStart, i, lineWidth) != 0) return 1;
+			lineStart = ++i;
+			lineWidth = 0;
+			canBreak = 0;
+			continue;
 		}
-		shootCooldown--;
 
-		if (conf->verbosity > 0) {
-			mvwprintw(objects->treeWin, 5, 5, "dx: %02d", dx);
-			mvwprintw(objects->treeWin, 6, 5, "dy: %02d", dy);
-			mvwprintw(objects->treeWin, 7, 5, "type: %d", type);
-			mvwprintw(objects->treeWin, 8, 5, "shootCooldown: % 3d", shootCooldown);
-		}
+		if (isspace((unsigned char) c)) {
+			if (breakEnd != i) {
+				breakStart = i;
+				breakWidth = lineWidth;
+			}
 
-		// move in x and y directions
-		x += dx;
-		y += dy;
+			// blanks that run past the edge end the line
+			if (lineWidth + 1 > maxWidth) {
+				if (wrapLine(wrapped, lineStart, breakStart, breakWidth) != 0) return 1;
+				while (message[i] && message[i] != '\n' && isspace((unsigned char) message[i])) i++;
+				lineStart = i;
+				lineWidth = 0;
+				canBreak = 0;
+				continue;
+			}
 
-		chooseColor(type, objects->treeWin, conf->nior);
+			lineWidth++;
+			breakEnd = ++i;
+			afterBreakWidth = lineWidth;
+			canBreak = breakStart > lineStart;
+			continue;
+		}
 
-		// choose string to use for this branch
-		char *branchStr = chooseString(conf, type, life, dx, dy);
+		size_t length;
+		int cw = messageChar(message + i, &state, &length);
+		while (lineWidth > 0 && lineWidth + cw > maxWidth) {
+			if (canBreak) {
+				// the word moves down to a line of its own
+				if (wrapLine(wrapped, lineStart, breakStart, breakWidth) != 0) return 1;
+				lineStart = breakEnd;
+				lineWidth -= afterBreakWidth;
+				canBreak = 0;
+			} else {
+				if (wrapLine(wrapped, lineStart, i, lineWidth) != 0) return 1;
+				lineStart = i;
+				lineWidth = 0;
+			}
+		}
+		lineWidth += cw;
+		i += length;
+	}
 
-		// grab wide character from branchStr
-		wchar_t wc = 0;
-		mbstate_t *ps = 0;
-		mbrtowc(&wc, branchStr, 32, ps);
+	if (lineStart < i || wrapped->count == 0) return wrapLine(wrapped, lineStart, i, lineWidth);
+	return 0;
+}
 
-		// print, but ensure wide characters don't overlap
-		if(x % wcwidth(wc) == 0)
-			mvwprintw(objects->treeWin, y, x, "%s", branchStr);
+void wrappedFree(struct wrappedMessage *wrapped) {
+	free(wrapped->lines);
+	memset(wrapped, 0, sizeof(*wrapped));
+}
 
-		wattroff(objects->treeWin, A_BOLD);
-		free(branchStr);
+// draw a layer's characters into a window
+void drawLayer(WINDOW* win, const struct layer *layer) {
+	for (int y = 0; y < layer->height; y++) {
+		for (int x = 0; x < layer->width; x++) {
+			const struct cell *cell = &layer->cells[y * layer->width + x];
+			if (!cell->str[0] || cell->width == 0) continue;
 
-		// if live, update screen
-		// skip updating if we're still loading from file
-		if (conf->live && !(conf->load && myCounters->branches < conf->targetBranchCount))
-			updateScreen(conf->timeStep);
+			wattrset(win, COLOR_PAIR(cell->color) | (cell->bold ? A_BOLD : 0));
+			mvwaddstr(win, y, x, cell->str);
+		}
 	}
+	wattrset(win, A_NORMAL);
 }
 
-void addSpaces(WINDOW* messageWin, int count, int *linePosition, int maxWidth) {
-	// add spaces if there's enough space
-	if (*linePosition < (maxWidth - count)) {
-		/* if (verbosity) mvwprintw(treeWin, 12, 5, "inserting a space: linePosition: %02d", *linePosition); */
-
-		// add spaces up to width
-		for (int j = 0; j < count; j++) {
-			wprintw(messageWin, " ");
-			(*linePosition)++;
+// fill a layer with base art
+void layerBase(struct layer *layer, const struct baseArt *art) {
+	for (int row = 0; row < art->height; row++) {
+		for (int x = 0; art->rows[row][x]; x++) {
+			if (art->colors[row][x] == ' ') continue;
+			layerPut(layer, row, x, &art->rows[row][x], 1, 1, (unsigned char) baseColor(art->colors[row][x]), (unsigned char) art->bold);
 		}
 	}
 }
 
 // create ncurses windows to contain message and message box
-void createMessageWindows(struct ncursesObjects *objects, char* message) {
+void createMessageWindows(struct ncursesObjects *objects, const struct wrappedMessage *wrapped) {
 	int maxY, maxX;
 	getmaxyx(stdscr, maxY, maxX);
 
-	int boxWidth = 0;
-	int boxHeight = 0;
-
-	if (strlen(message) + 3 <= (0.25 * maxX)) {
-		boxWidth = strlen(message) + 1;
-		boxHeight = 1;
-	} else {
-		boxWidth = 0.25 * maxX;
-		boxHeight = (strlen(message) / boxWidth) + (strlen(message) / boxWidth);
-	}
-
 	// create separate box for message border
-	objects->messageBorderWin = newwin(boxHeight + 2, boxWidth + 4, (maxY * 0.7) - 1, (maxX * 0.7) - 2);
-	objects->messageWin = newwin(boxHeight, boxWidth + 1, maxY * 0.7, maxX * 0.7);
+	objects->messageBorderWin = newwin(wrapped->boxHeight + 2, wrapped->boxWidth + 4, (maxY * 0.7) - 1, (maxX * 0.7) - 2);
+	objects->messageWin = newwin(wrapped->boxHeight, wrapped->boxWidth + 1, maxY * 0.7, maxX * 0.7);
 
 	// draw box
 	wattron(objects->messageBorderWin, COLOR_PAIR(8) | A_BOLD);
@@ -798,94 +2697,247 @@ void createMessageWindows(struct ncursesObjects *objects, char* message) {
 	objects->messagePanel = new_panel(objects->messageWin);
 }
 
+// write a wrapped message into a layer, blanks as spaces; debugWin gets
+// verbose output, if any
+void layoutMessage(const struct config *conf, WINDOW* debugWin, struct layer *messageLayer, const struct wrappedMessage *wrapped) {
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+
+	for (int y = 0; y < wrapped->count && y < messageLayer->height; y++) {
+		const struct messageLine *line = &wrapped->lines[y];
+		if (debugWin && conf->verbosity) {
+			mvwprintw(debugWin, 9, 5, "index: %03zu", line->start);
+			mvwprintw(debugWin, 10, 5, "lineWidth: %02d", line->width);
+		}
+
+		int x = 0;
+		for (size_t i = line->start; i < line->end; ) {
+			const char *str = wrapped->message + i;
+			size_t length;
+			int cw = messageChar(str, &state, &length);
+			if (isspace((unsigned char) *str)) layerPut(messageLayer, y, x, " ", 1, 1, 0, 0);
+			else layerPut(messageLayer, y, x, str, length, cw, 0, 0);
+			x += cw;
+			i += length;
+		}
+
+		if (debugWin && conf->verbosity >= 2) updateScreen(1);
+	}
+}
+
+// lay the message out on its own, then copy it over
+void fillMessage(const struct config *conf, struct ncursesObjects *objects, const struct wrappedMessage *wrapped) {
+	struct layer messageLayer;
+	memset(&messageLayer, 0, sizeof(messageLayer));
+	if (layerInit(NULL, &messageLayer, getmaxy(objects->messageWin), getmaxx(objects->messageWin), 0, 0) != 0) return;
+
+	werase(objects->messageWin);
+	layoutMessage(conf, objects->treeWin, &messageLayer, wrapped);
+	drawLayer(objects->messageWin, &messageLayer);
+	layerFree(&messageLayer);
+}
+
 int drawMessage(const struct config *conf, struct ncursesObjects *objects, char* message) {
 	if (!message) return 1;
 
-	createMessageWindows(objects, message);
-
-	int maxWidth = getmaxx(objects->messageWin) - 2;
-
-	// word wrap message as it is written
-	unsigned int i = 0;
-	int linePosition = 0;
-	int wordLength = 0;
-	char wordBuffer[512] = {'\0'};
-	char thisChar;
-	while (true) {
-		thisChar = message[i];
-		if (conf->verbosity) {
-			mvwprintw(objects->treeWin, 9, 5, "index: %03d", i);
-			mvwprintw(objects->treeWin, 10, 5, "linePosition: %02d", linePosition);
-		}
-
-		// append this character to word buffer,
-		// if it's not space or NULL and it can fit
-		if (!(isspace(thisChar) || thisChar == '\0') && wordLength < (int) (sizeof(wordBuffer) / sizeof(wordBuffer[0]))) {
-			strncat(wordBuffer, &thisChar, 1);
-			wordLength++;
-			linePosition++;
-		}
-
-		// if char is space or null char
-		else if (isspace(thisChar) || thisChar == '\0') {
-
-			// if current line can fit word, add word to current line
-			if (linePosition <= maxWidth) {
-				wprintw(objects->messageWin, "%s", wordBuffer);	// print word
-				wordLength = 0;		// reset word length
-				wordBuffer[0] = '\0';	// clear word buffer
-
-				switch (thisChar) {
-				case ' ':
-					addSpaces(objects->messageWin, 1, &linePosition, maxWidth);
-					break;
-				case '\t':
-					addSpaces(objects->messageWin, 1, &linePosition, maxWidth);
-					break;
-				case '\n':
-					waddch(objects->messageWin, thisChar);
-					linePosition = 0;
-					break;
-				}
+	struct wrappedMessage wrapped;
+	if (wrapMessage(message, getmaxx(stdscr), &wrapped) != 0) {
+		wrappedFree(&wrapped);
+		return 1;
+	}
 
-			}
+	createMessageWindows(objects, &wrapped);
+	if (objects->messageWin) fillMessage(conf, objects, &wrapped);
+	wrappedFree(&wrapped);
+	return objects->messageWin ? 0 : 1;
+}
 
-			// if word can't fit within a single line, just print it
-			else if (wordLength > maxWidth) {
-				wprintw(objects->messageWin, "%s ", wordBuffer);	// print word
-				wordLength = 0;		// reset word length
-				wordBuffer[0] = '\0';	// clear word buffer
+// fit the windows to a resized terminal, moving and resizing the ones there
+// are, and draw the strokes of the first frames again in the order they were
+// first drawn; nothing is grown again
+void resizeWins(const struct config *conf, struct ncursesObjects *objects, const struct tree *trees, int forest, size_t frames) {
+	int rows, cols;
+#ifdef _WIN32
+	resize_term(0, 0);
+#else
+	terminalSize(&rows, &cols);
+	resizeterm(rows, cols);
+#endif
+	getmaxyx(stdscr, rows, cols);
 
-				// our line position on this new line is the x coordinate
-				int y;
-				(void) y;
-				getyx(objects->messageWin, y, linePosition);
+	const struct baseArt *art = &baseArts[conf->baseType];
+	int baseOriginY = rows - art->height;
+	if (conf->baseType == 3) baseOriginY -= 1;
+
+	wresize(objects->treeWin, rows - art->height, cols);
+	werase(objects->treeWin);
+	if (conf->live) {
+		int originY[MAX_FOREST], originX[MAX_FOREST];
+		for (int i = 0; i < forest; i++) treeOrigin(objects->treeWin, i, forest, &originY[i], &originX[i]);
+
+		for (size_t frame = 0; frame < frames; frame++) {
+			int drawn = 0;
+			for (int i = 0; i < forest; i++) {
+				if (frame >= trees[i].count) continue;
+				drawStroke(objects->treeWin, &trees[i].strokes[frame], originY[i], originX[i]);
+				drawn = 1;
 			}
+			if (!drawn) break;
+		}
+	} else {
+		for (int i = 0; i < forest; i++)
+			drawTree(objects->treeWin, &trees[i], i, forest);
+	}
 
-			// if current line can't fit word, go to next line
-			else {
-				if (conf->verbosity) mvwprintw(objects->treeWin, (i / 24) + 28, 5, "couldn't fit word. linePosition: %02d, wordLength: %02d", linePosition, wordLength);
-				wprintw(objects->messageWin, "\n%s ", wordBuffer); // print newline, then word
-				linePosition = wordLength;	// reset line position
-				wordLength = 0;		// reset word length
-				wordBuffer[0] = '\0';	// clear word buffer
-			}
+	// curses won't move a window partly off screen, so a base that doesn't
+	// fit whole any more is hidden until it does
+	for (int i = 0; i < forest && art->width > 0; i++) {
+		int baseOriginX = forestColumn(cols, i, forest) - (art->width / 2);
+		if (baseOriginX < 0 || baseOriginY < 0 || baseOriginX + art->width > cols) {
+			if (objects->basePanel[i]) hide_panel(objects->basePanel[i]);
+			continue;
 		}
-		else {
-			printf("%s", "Error while parsing message");
-			return 1;
+
+		if (!objects->baseWin[i]) {
+			objects->baseWin[i] = newwin(art->height, art->width, baseOriginY, baseOriginX);
+			if (!objects->baseWin[i]) continue;
+			objects->basePanel[i] = new_panel(objects->baseWin[i]);
+		} else {
+			// resizeterm() cuts windows down to the screen
+			wresize(objects->baseWin[i], art->height, art->width);
+			move_panel(objects->basePanel[i], baseOriginY, baseOriginX);
+			show_panel(objects->basePanel[i]);
+		}
+		werase(objects->baseWin[i]);
+		drawBase(objects->baseWin[i], conf->baseType);
+	}
+
+	if (objects->messageWin) {
+		struct wrappedMessage wrapped;
+		if (wrapMessage(conf->message, cols, &wrapped) == 0) {
+			wresize(objects->messageBorderWin, wrapped.boxHeight + 2, wrapped.boxWidth + 4);
+			wresize(objects->messageWin, wrapped.boxHeight, wrapped.boxWidth + 1);
+			move_panel(objects->messageBorderPanel, (rows * 0.7) - 1, (cols * 0.7) - 2);
+			move_panel(objects->messagePanel, rows * 0.7, cols * 0.7);
+			top_panel(objects->messageBorderPanel);
+			top_panel(objects->messagePanel);
+
+			werase(objects->messageBorderWin);
+			wborder(objects->messageBorderWin, '|', '|', '-', '-', '+', '+', '+', '+');
+			fillMessage(conf, objects, &wrapped);
+		}
+		wrappedFree(&wrapped);
+	}
+}
+
+// wait up to timeout seconds (forever if negative) for a key, fitting the
+// screen to the terminal whenever it's resized meanwhile; ERR if none came
+int waitKey(struct config *conf, struct ncursesObjects *objects, const struct tree *trees, int forest, double timeout) {
+	double giveUp = monotonicTime() + timeout;
+	int key = ERR;
+
+	while (1) {
+		double wait = giveUp - monotonicTime();
+		if (timeout >= 0 && wait <= 0) break;
+
+		wtimeout(stdscr, timeout < 0 ? -1 : (int) (wait * 1000) + 1);
+		key = wgetch(stdscr);
+		if (key == KEY_RESIZE) terminalResized = 1;
+
+		if (terminalResized) {
+			terminalResized = 0;
+			resizeWins(conf, objects, trees, forest, SIZE_MAX);
+			update_panels();
+			doupdate();
+			if (conf->recording) recordScreen(conf);
 		}
+		if (key != ERR && key != KEY_RESIZE) break;
+		key = ERR;
+	}
+
+	nodelay(stdscr, TRUE);
+	return key;
+}
+
+// lay a whole screen out on a canvas, the way drawWins and drawMessage lay out windows
+int canvasLayout(struct canvas *canvas, const struct config *conf, int forest, int rows, int cols) {
+	if (canvasInit(canvas, rows, cols) != 0) return 1;
+
+	const struct baseArt *art = &baseArts[conf->baseType];
+	int baseOriginY = rows - art->height;
+	// base 3 needs to overlap 1 row higher to connect with trunk
+	if (conf->baseType == 3) baseOriginY -= 1;
+
+	layerInit(canvas, &canvas->tree, rows - art->height, cols, 0, 0);
+
+	for (int i = 0; i < forest && art->width > 0; i++) {
+		// newwin() refuses a base that starts off screen, so none is shown
+		int baseOriginX = forestColumn(cols, i, forest) - (art->width / 2);
+		if (baseOriginX < 0) continue;
+		layerInit(canvas, &canvas->base[i], art->height, art->width, baseOriginY, baseOriginX);
+		layerBase(&canvas->base[i], art);
+	}
+
+	if (!conf->message) return 0;
+
+	struct wrappedMessage wrapped;
+	if (wrapMessage(conf->message, cols, &wrapped) != 0) {
+		wrappedFree(&wrapped);
+		return 0;
+	}
 
-		if (conf->verbosity >= 2) {
-			updateScreen(1);
-			mvwprintw(objects->treeWin, 11, 5, "word buffer: |% 15s|", wordBuffer);
+	struct layer *border = &canvas->messageBorder;
+	if (layerInit(canvas, border, wrapped.boxHeight + 2, wrapped.boxWidth + 4, (rows * 0.7) - 1, (cols * 0.7) - 2) == 0) {
+		for (int y = 0; y < border->height; y++) {
+			for (int x = 0; x < border->width; x++) {
+				int edgeY = y == 0 || y == border->height - 1;
+				int edgeX = x == 0 || x == border->width - 1;
+				if (edgeY || edgeX) layerPut(border, y, x, edgeY && edgeX ? "+" : edgeY ? "-" : "|", 1, 1, 8, 1);
+			}
 		}
-		if (thisChar == '\0') break;	// quit when we reach the end of the message
-		i++;
 	}
+
+	if (layerInit(canvas, &canvas->message, wrapped.boxHeight, wrapped.boxWidth + 1, rows * 0.7, cols * 0.7) == 0)
+		layoutMessage(conf, NULL, &canvas->message, &wrapped);
+	wrappedFree(&wrapped);
 	return 0;
 }
 
+// print the canvas as ANSI text, like printstdscr does for curses; into
+// render if given, otherwise to stdout
+void canvasPrint(const struct canvas *canvas, int isNoir, struct buffer *render) {
+	struct buffer out = { NULL, 0, 0 };
+
+	for (int y = 0; y < canvas->rows; y++) {
+		// trailing blanks are left out
+		int end = canvas->cols;
+		while (end > 0 && !canvasCell(canvas, y, end - 1)->str[0]) end--;
+
+		int color = -1, bold = -1;
+		for (int x = 0; x < end; x++) {
+			struct cell cell = canvasVisible(canvas, y, x);
+			if (cell.width == 0) continue;
+
+			int cellColor = canvasColor(canvas, cell.color, isNoir);
+			if (cellColor != color || cell.bold != bold) {
+				appendSGR(&out, cellColor, cell.bold);
+				color = cellColor;
+				bold = cell.bold;
+			}
+			bufferPrint(&out, cell.str[0] ? cell.str : " ");
+		}
+		bufferPrint(&out, "\033[0m\n");
+	}
+
+	if (render) {
+		bufferAppend(render, out.data, out.length);
+	} else {
+		fwrite(out.data, 1, out.length, stdout);
+		fflush(stdout);
+	}
+	free(out.data);
+}
+
 void init(const struct config *conf, struct ncursesObjects *objects) {
 	savetty();	// save terminal settings
 	initscr();	// init ncurses screen
@@ -893,6 +2945,7 @@ void init(const struct config *conf, struct ncursesObjects *objects) {
 	curs_set(0);	// make cursor invisible
 	cbreak();	// don't wait for new line to grab user input
 	nodelay(stdscr, TRUE);	// force getch to be a non-blocking call
+	watchResize();	// take SIGWINCH over from curses
 
 	// if terminal has color capabilities, use them & not noir
 	if (!conf->nior) {
@@ -950,31 +3003,349 @@ void init(const struct config *conf, struct ncursesObjects *objects) {
 	}
 
 	// define and draw windows, then create panels
-	drawWins(conf->baseType, objects);
+	drawWins(conf->baseType, forestSize(conf, COLS), objects);
 	drawMessage(conf, objects, conf->message);
 }
 
-void growTree(struct config *conf, struct ncursesObjects *objects, struct counters *myCounters) {
+// grow and show the trees; returns how many there are
+int growTree(struct config *conf, struct ncursesObjects *objects, struct counters *myCounters, struct tree *trees) {
 	int maxY, maxX;
 	getmaxyx(objects->treeWin, maxY, maxX);
-
-	// reset counters
-	myCounters->shoots = 0;
-	myCounters->branches = 0;
-	myCounters->shootCounter = rand();
+	int forest = forestSize(conf, COLS);
 
 	if (conf->verbosity > 0) {
 		mvwprintw(objects->treeWin, 2, 5, "maxX: %03d, maxY: %03d", maxX, maxY);
 	}
 
-	// recursively grow tree trunk and branches
-	branch(conf, objects, myCounters, maxY - 1, (maxX / 2), trunk, conf->lifeStart);
+	// grow the trees first, then place them
+	growTrees(conf, myCounters, trees, forest);
+
+	if (conf->verbosity > 0) {
+		mvwprintw(objects->treeWin, 4, 5, "shoots: %02d", myCounters->shoots);
+	}
+
+	if (conf->live) {
+		animateForest(conf, objects, myCounters, trees, forest);
+	} else {
+		for (int i = 0; i < forest; i++)
+			drawTree(objects->treeWin, &trees[i], i, forest);
+	}
+
+	if (conf->verbosity > 0) {
+		mvwprintw(objects->treeWin, 3, 5, "tree: %d x %d, %zu strokes",
+			trees[0].maxX - trees[0].minX + 1, trees[0].maxY - trees[0].minY + 1, trees[0].count);
+		mvwprintw(objects->treeWin, 12, 5, "cells: %d, overdraw: %d, skipped: %d",
+			myCounters->cells, myCounters->overdraw, myCounters->skipped);
+		mvwprintw(objects->treeWin, 13, 5, "steps: %d", myCounters->steps);
+		mvwprintw(objects->treeWin, 14, 5, "dropped frames: %d", myCounters->dropped);
+	}
 
 	// display changes
 	update_panels();
 	doupdate();
+
+	// a tree that isn't animated is a single frame
+	if (conf->recording && !conf->live) recordScreen(conf);
+	return forest;
+}
+
+#ifndef _WIN32
+// signals that end cbonsai while the canvas renderer has the terminal; they
+// only set terminalStopSignal, so the terminal is put back before leaving
+static const int stopSignals[] = { SIGINT, SIGTERM, SIGHUP };
+#define STOP_SIGNALS ((int) (sizeof(stopSignals) / sizeof(stopSignals[0])))
+
+volatile sig_atomic_t terminalStopSignal = 0;
+
+void onStopSignal(int sig) {
+	terminalStopSignal = sig;
+}
+
+// the terminal as the canvas renderer drives it, without curses
+struct terminal {
+	struct termios saved;
+	struct sigaction savedActions[STOP_SIGNALS];
+	int rows, cols;
+};
+
+// guess what COLORS would be from the environment, without terminfo
+int terminalColors(void) {
+	const char *term = getenv("TERM");
+	if (getenv("COLORTERM") || (term && strstr(term, "256color"))) return 256;
+	return 8;
+}
+
+// keys without waiting for enter or echoing them, an alternate screen, no cursor
+int terminalStart(struct terminal *term) {
+	if (tcgetattr(STDIN_FILENO, &term->saved) != 0) return 1;
+
+	struct termios raw = term->saved;
+	raw.c_lflag &= ~(ICANON | ECHO);
+	raw.c_cc[VMIN] = 0;
+	raw.c_cc[VTIME] = 0;
+	if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) != 0) return 1;
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onStopSignal;
+	sigemptyset(&action.sa_mask);
+	for (int i = 0; i < STOP_SIGNALS; i++) sigaction(stopSignals[i], &action, &term->savedActions[i]);
+
+	terminalSize(&term->rows, &term->cols);
+	fputs("\033[?1049h\033[?25l", stdout);
+	fflush(stdout);
+	return 0;
+}
+
+void terminalStop(struct terminal *term) {
+	fputs("\033[0m\033[?25h\033[?1049l", stdout);
+	fflush(stdout);
+	tcsetattr(STDIN_FILENO, TCSANOW, &term->saved);
+	for (int i = 0; i < STOP_SIGNALS; i++) sigaction(stopSignals[i], &term->savedActions[i], NULL);
+}
+
+// write all of a buffer to the terminal
+void terminalWrite(const struct buffer *buf) {
+	size_t done = 0;
+	while (done < buf->length) {
+		ssize_t n = write(STDOUT_FILENO, buf->data + done, buf->length - done);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return;
+		done += (size_t) n;
+	}
+}
+
+#endif
+
+#ifndef _WIN32
+// the canvas version of resizeWins: lay the screen out for the terminal's
+// size and put the strokes of the first frames on it
+void canvasFit(const struct config *conf, struct canvas *canvas, const struct tree *trees, int forest, size_t frames) {
+	int rows, cols;
+	screenSize(conf, &rows, &cols);
+	canvasLayout(canvas, conf, forest, rows, cols);
+
+	struct layer *layer = &canvas->tree;
+	if (conf->live) {
+		for (size_t frame = 0; frame < frames; frame++) {
+			int drawn = 0;
+			for (int i = 0; i < forest; i++) {
+				if (frame >= trees[i].count) continue;
+				layerStroke(layer, &trees[i].strokes[frame], layer->height - 1, forestColumn(layer->width, i, forest));
+				drawn = 1;
+			}
+			if (!drawn) break;
+		}
+	} else {
+		for (int i = 0; i < forest; i++)
+			for (size_t k = 0; k < trees[i].count; k++)
+				layerStroke(layer, &trees[i].strokes[k], layer->height - 1, forestColumn(layer->width, i, forest));
+	}
+}
+
+// send a frame to the terminal and the recording, if any
+void canvasShow(struct config *conf, struct canvas *canvas, struct buffer *out) {
+	out->length = 0;
+	canvasRender(canvas, conf->nior, out);
+	terminalWrite(out);
+	if (conf->recording) recordEvent(conf, out);
+}
+
+// wait up to timeout seconds (forever if negative) for a key that quits:
+// any key in screensaver mode, otherwise 'q'; the screen is fitted to the
+// terminal whenever it's resized meanwhile; returns 1 if a key came
+int terminalWaitQuit(struct config *conf, struct canvas *canvas, const struct tree *trees, int forest, double timeout) {
+	double giveUp = monotonicTime() + timeout;
+	struct buffer out = { NULL, 0, 0 };
+	int quitting = 0;
+
+	while (1) {
+		double wait = timeout < 0 ? -1 : giveUp - monotonicTime();
+		if (timeout >= 0 && wait <= 0) break;
+
+		struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+		int ready = poll(&pfd, 1, wait < 0 ? -1 : (int) (wait * 1000) + 1);
+
+		if (terminalStopSignal) {
+			quitting = 1;
+			break;
+		}
+		if (terminalResized) {
+			terminalResized = 0;
+			canvasFit(conf, canvas, trees, forest, SIZE_MAX);
+			canvasShow(conf, canvas, &out);
+		}
+		if (ready <= 0) continue;
+
+		unsigned char key;
+		if (read(STDIN_FILENO, &key, 1) == 1 && (conf->screensaver || key == 'q' || timeout < 0)) {
+			quitting = 1;
+			break;
+		}
+	}
+
+	free(out.data);
+	return quitting;
+}
+
+// the canvas version of animateForest: one buffered write per frame, only
+// the cells that changed
+int animateCanvas(struct config *conf, struct canvas *canvas, struct counters *myCounters, const struct tree *trees, int forest) {
+	struct layer *layer = &canvas->tree;
+	size_t frames = 0;
+	for (int i = 0; i < forest; i++)
+		if (trees[i].count > frames) frames = trees[i].count;
+
+	struct buffer out = { NULL, 0, 0 };
+	double due = 0;
+	struct terminalProbe probe;
+	probeStart(&probe);
+	myCounters->branches = 0;
+
+	// without live mode the trees are drawn one after another, as drawTree does
+	if (!conf->live) {
+		for (int i = 0; i < forest; i++) {
+			for (size_t k = 0; k < trees[i].count; k++) {
+				const struct stroke *stroke = &trees[i].strokes[k];
+				layerStroke(layer, stroke, layer->height - 1, forestColumn(layer->width, i, forest));
+				if (stroke->branch > myCounters->branches) myCounters->branches = stroke->branch;
+			}
+		}
+		frames = 0;
+	}
+
+	for (size_t frame = 0; frame < frames; frame++) {
+		unsigned char keys[64];
+		int count = probeRead(&probe, keys, sizeof(keys));
+		for (int i = 0; i < count; i++) {
+			if (conf->screensaver || keys[i] == 'q') {
+				free(out.data);
+				return 1;
+			}
+		}
+		if (terminalStopSignal) {
+			free(out.data);
+			return 1;
+		}
+
+		if (terminalResized) {
+			terminalResized = 0;
+			canvasFit(conf, canvas, trees, forest, frame);
+		}
+
+		for (int i = 0; i < forest; i++) {
+			if (frame >= trees[i].count) continue;
+
+			const struct stroke *stroke = &trees[i].strokes[frame];
+			layerStroke(layer, stroke, layer->height - 1, forestColumn(layer->width, i, forest));
+			if (stroke->branch > myCounters->branches) myCounters->branches = stroke->branch;
+		}
+
+		// while loading, only the loaded tree is shown
+		if (frame + 1 < frames && conf->load && myCounters->branches < conf->targetBranchCount)
+			continue;
+
+		if (due == 0) due = monotonicTime();
+		due += conf->timeStep;
+
+		// when the terminal lags, cells just stay dirty until a later frame
+		if (frame + 1 == frames || (monotonicTime() < due && !probeBehind(&probe) && outputBacklog() <= MAX_BACKLOG)) {
+			canvasShow(conf, canvas, &out);
+			probeSend(&probe);
+		} else {
+			myCounters->dropped++;
+		}
+		if (conf->recording) conf->recordTime += conf->timeStep;
+		sleepUntil(due);
+	}
+
+	// shown all at once: the whole tree, or its base and message if it has no strokes
+	if (frames == 0) canvasShow(conf, canvas, &out);
+
+	probeFinish(&probe);
+	free(out.data);
+	return 0;
+}
+
+// print mode without live growth needs no screen at all, so no curses:
+// the trees are laid out on a canvas the terminal's size and printed
+int printCanvas(struct config *conf, struct counters *myCounters, struct tree *trees) {
+	struct canvas canvas;
+	memset(&canvas, 0, sizeof(canvas));
+	canvas.colors = terminalColors();
+
+	int rows, cols;
+	screenSize(conf, &rows, &cols);
+	int forest = forestSize(conf, cols);
+	growTrees(conf, myCounters, trees, forest);
+	canvasFit(conf, &canvas, trees, forest, SIZE_MAX);
+	canvasPrint(&canvas, conf->nior, conf->render);
+
+	myCounters->branches = 0;
+	for (int i = 0; i < forest; i++)
+		for (size_t k = 0; k < trees[i].count; k++)
+			if (trees[i].strokes[k].branch > myCounters->branches) myCounters->branches = trees[i].strokes[k].branch;
+	if (conf->save)
+		saveToFile(conf->saveFile, conf->seed, myCounters->branches);
+
+	canvasFree(&canvas);
+	return 0;
 }
 
+// grow and show trees with the canvas renderer instead of curses
+int runCanvas(struct config *conf, struct counters *myCounters, struct tree *trees) {
+	struct terminal term;
+	if (terminalStart(&term) != 0) {
+		printf("error: the diff renderer needs a terminal\n");
+		return 1;
+	}
+
+	struct canvas canvas;
+	memset(&canvas, 0, sizeof(canvas));
+	canvas.colors = terminalColors();
+	int quitting = 0;
+
+	int forest = 0;
+	watchResize();
+
+	do {
+		terminalSize(&term.rows, &term.cols);
+		forest = forestSize(conf, term.cols);
+		canvasLayout(&canvas, conf, forest, term.rows, term.cols);
+		if (conf->recordFile && !conf->recording && startRecording(conf, term.rows, term.cols) != 0) break;
+
+		growTrees(conf, myCounters, trees, forest);
+		quitting = animateCanvas(conf, &canvas, myCounters, trees, forest);
+		if (conf->load) conf->targetBranchCount = 0;
+
+		if (!quitting && conf->infinite) {
+			quitting = terminalWaitQuit(conf, &canvas, trees, forest, conf->timeWait);
+			conf->seed = time(NULL);
+			conf->recordTime += conf->timeWait;
+		}
+	} while (conf->infinite && !quitting);
+
+	if (!quitting && !conf->printTree) terminalWaitQuit(conf, &canvas, trees, forest, -1);
+	terminalStop(&term);
+
+	// stopped by a signal: the terminal is back as it was, so die of it now
+	if (terminalStopSignal) {
+		stopRecording(conf);
+		canvasFree(&canvas);
+		raise(terminalStopSignal);
+		return 1;
+	}
+
+	if (conf->printTree) canvasPrint(&canvas, conf->nior, NULL);
+	stopRecording(conf);
+	if (conf->save)
+		saveToFile(conf->saveFile, conf->seed, myCounters->branches);
+
+	canvasFree(&canvas);
+	return 0;
+}
+#endif
+
 // print stdscr to terminal window
 void printstdscr(int isNoir) {
 	int maxY, maxX;
@@ -1064,6 +3435,12 @@ void printstdscr(int isNoir) {
 				else if (fg >= 8) printf("\033[9%him", fg - 8);
 			}
 
+			// a lone ascii character is its own byte and a single column
+			if (wch[0] >= L' ' && wch[0] <= L'~' && wch[1] == 0) {
+				putchar((int) wch[0]);
+				continue;
+			}
+
 			printf("%ls", wch);
 
 			short clen = (short)wcslen(wch);
@@ -1140,7 +3517,9 @@ char* createDefaultCachePath(void) {
 	return result;
 }
 
-int cbonsai_run(int argc, char* argv[]) {
+// run with the given arguments; with render set, print mode is implied and
+// prints into it, for a screen rows by cols (0 for the terminal's size)
+int cbonsaiRun(int argc, char* argv[], struct buffer *render, int rows, int cols) {
 	setlocale(LC_ALL, "");
 
 	struct config conf = {
@@ -1158,6 +3537,12 @@ int cbonsai_run(int argc, char* argv[]) {
 		.save = 0,
 		.load = 0,
 		.targetBranchCount = 0,
+		.skipOverdraw = 0,
+		.budget = 0,
+		.jobs = 1,
+		.forest = 1,
+		.scan = 10000,
+		.diffRender = 0,
 
 		.timeWait = 4,
 		.timeStep = 0.03,
@@ -1166,6 +3551,14 @@ int cbonsai_run(int argc, char* argv[]) {
 		.leaves = {0},
 		.saveFile = createDefaultCachePath(),
 		.loadFile = createDefaultCachePath(),
+		.search = NULL,
+		.recordFile = NULL,
+		.replayFile = NULL,
+		.recording = NULL,
+
+		.render = render,
+		.rows = rows,
+		.cols = cols,
 	};
 
 	struct option long_options[] = {
@@ -1184,20 +3577,31 @@ int cbonsai_run(int argc, char* argv[]) {
 		{"seed", required_argument, NULL, 's'},
 		{"save", required_argument, NULL, 'W'},
 		{"load", required_argument, NULL, 'C'},
+		{"skip-overdraw", no_argument, NULL, 'O'},
+		{"budget", required_argument, NULL, 'B'},
+		{"jobs", required_argument, NULL, 'j'},
+		{"forest", required_argument, NULL, 'F'},
+		{"search", required_argument, NULL, 'X'},
+		{"scan", required_argument, NULL, 'N'},
+		{"record", required_argument, NULL, 'R'},
+		{"replay", required_argument, NULL, 'r'},
+		{"diff-render", no_argument, NULL, 'd'},
 		{"verbose", no_argument, NULL, 'v'},
 		{"help", no_argument, NULL, 'h'},
 		{0, 0, 0, 0}
 	};
 
-	struct ncursesObjects objects = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+	struct ncursesObjects objects;
+	memset(&objects, 0, sizeof(objects));
 
 	char leavesInput[128] = "&";
 	int customLeaves = 0;  // track if user specified custom leaves
+	int customJobs = 0;  // track if user specified a thread count
 
 	// parse arguments
 	int option_index = 0;
 	int c;
-	while ((c = getopt_long(argc, argv, ":lt:niw:Sm:b:c:M:L:ps:C:W:vh", long_options, &option_index)) != -1) {
+	while ((c = getopt_long(argc, argv, ":lt:niw:Sm:b:c:M:L:ps:C:W:OB:j:F:X:N:R:r:dvh", long_options, &option_index)) != -1) {
 		switch (c) {
 		case 'l':
 			conf.live = 1;
@@ -1250,7 +3654,7 @@ int cbonsai_run(int argc, char* argv[]) {
                         errno = 0;
                         strtold(optarg, NULL);
                         if (!errno) conf.baseType = strtod(optarg, NULL);
-			else {
+			if (errno || conf.baseType < 0 || conf.baseType >= BASE_TYPES) {
 				printf("error: invalid base index: '%s'\n", optarg);
 				quit(&conf, &objects, 1);
 			}
@@ -1322,6 +3726,57 @@ int cbonsai_run(int argc, char* argv[]) {
 
 			conf.load = 1;
 			break;
+		case 'O':
+			conf.skipOverdraw = 1;
+			break;
+		case 'B':
+			if (strtold(optarg, NULL) != 0) conf.budget = strtod(optarg, NULL);
+			else {
+				printf("error: invalid step budget: '%s'\n", optarg);
+				quit(&conf, &objects, 1);
+			}
+			if (conf.budget < 0) {
+				printf("error: invalid step budget: '%s'\n", optarg);
+				quit(&conf, &objects, 1);
+			}
+			break;
+		case 'j':
+			errno = 0;
+			conf.jobs = strtol(optarg, NULL, 10);
+			customJobs = 1;
+			if (errno || conf.jobs < 0) {
+				printf("error: invalid job count: '%s'\n", optarg);
+				quit(&conf, &objects, 1);
+			}
+			break;
+		case 'F':
+			errno = 0;
+			conf.forest = strtol(optarg, NULL, 10);
+			if (errno || conf.forest < 0 || conf.forest > MAX_FOREST) {
+				printf("error: invalid forest size: '%s'\n", optarg);
+				quit(&conf, &objects, 1);
+			}
+			break;
+		case 'X':
+			conf.search = optarg;
+			break;
+		case 'N':
+			errno = 0;
+			conf.scan = strtol(optarg, NULL, 10);
+			if (errno || conf.scan < 1) {
+				printf("error: invalid seed count: '%s'\n", optarg);
+				quit(&conf, &objects, 1);
+			}
+			break;
+		case 'R':
+			conf.recordFile = optarg;
+			break;
+		case 'r':
+			conf.replayFile = optarg;
+			break;
+		case 'd':
+			conf.diffRender = 1;
+			break;
 		case 'v':
 			conf.verbosity++;
 			break;
@@ -1369,52 +3824,130 @@ int cbonsai_run(int argc, char* argv[]) {
 		token = strtok(NULL, ",");
 		conf.leavesSize++;
 	}
+	conf.asciiLeaves = leavesAscii(&conf);
+
+	// replaying only copies a recording to the terminal
+	if (conf.replayFile) {
+		int returnCode = replayRecording(conf.replayFile);
+		free(conf.saveFile);
+		free(conf.loadFile);
+		return returnCode;
+	}
+
+	// searching grows trees without ever opening a screen
+	if (conf.search) {
+		if (!customJobs) conf.jobs = 0;
+		int returnCode = searchSeeds(&conf);
+		free(conf.saveFile);
+		free(conf.loadFile);
+		return returnCode;
+	}
 
 	if (conf.load)
 		loadFromFile(&conf);
 
 	// seed random number generator
 	if (conf.seed == 0) conf.seed = time(NULL);
-	srand(conf.seed);
 
 	struct counters myCounters;
+	struct tree trees[MAX_FOREST];
+	memset(trees, 0, sizeof(trees));
+	int forest = 0;
+
+#ifndef _WIN32
+	if (conf.render) conf.printTree = 1;
+	int headless = conf.printTree && !conf.live && !conf.infinite && !conf.verbosity && !conf.recordFile;
+
+	// only print mode can draw into memory
+	if (conf.render && !headless) {
+		free(conf.saveFile);
+		free(conf.loadFile);
+		return 1;
+	}
+
+#ifdef CBONSAI_LAZY_CURSES
+	// without curses, the diff renderer draws instead
+	if (!headless && !conf.diffRender && !loadCurses()) conf.diffRender = 1;
+#endif
+
+	// neither printing nor the diff renderer use curses at all
+	if (headless || conf.diffRender) {
+		int returnCode = headless ? printCanvas(&conf, &myCounters, trees) : runCanvas(&conf, &myCounters, trees);
+		for (int i = 0; i < MAX_FOREST; i++) treeFree(&trees[i]);
+		free(conf.saveFile);
+		free(conf.loadFile);
+		return returnCode;
+	}
+#endif
 
 	do {
 		init(&conf, &objects);
-		growTree(&conf, &objects, &myCounters);
+		if (conf.recordFile && !conf.recording && startRecording(&conf, LINES, COLS) != 0) {
+			finish(&conf, &myCounters);
+			quit(&conf, &objects, 1);
+		}
+		forest = growTree(&conf, &objects, &myCounters, trees);
 		if (conf.load) conf.targetBranchCount = 0;
 		if (conf.infinite) {
-			timeout(conf.timeWait * 1000);
-			if (checkKeyPress(&conf, &myCounters) == 1)
+			if (quitKey(&conf, waitKey(&conf, &objects, trees, forest, conf.timeWait))) {
+				finish(&conf, &myCounters);
 				quit(&conf, &objects, 0);
+			}
 
 			// seed random number generator
-			srand(time(NULL));
+			conf.seed = time(NULL);
+			conf.recordTime += conf.timeWait;
 		}
 	} while (conf.infinite);
 
+	stopRecording(&conf);
+
 	if (conf.printTree) {
 		finish(&conf, &myCounters);
 
 		// overlay all windows onto stdscr
-		overlay(objects.baseWin, stdscr);
 		overlay(objects.treeWin, stdscr);
+		for (int i = 0; i < MAX_FOREST; i++)
+			if (objects.baseWin[i]) overlay(objects.baseWin[i], stdscr);
 		overwrite(objects.messageBorderWin, stdscr);
 		overwrite(objects.messageWin, stdscr);
 
 		printstdscr(conf.nior);
 	} else {
-		wgetch(objects.treeWin);
+		waitKey(&conf, &objects, trees, forest, -1);
 		finish(&conf, &myCounters);
 	}
 
 	// cleanup without exit (for library usage)
 	delObjects(&objects);
+	for (int i = 0; i < MAX_FOREST; i++) treeFree(&trees[i]);
 	free(conf.saveFile);
 	free(conf.loadFile);
 	return 0;
 }
 
+int cbonsai_run(int argc, char* argv[]) {
+	return cbonsaiRun(argc, argv, NULL, 0, 0);
+}
+
+char *cbonsai_render(int argc, char *argv[], int rows, int cols, size_t *length) {
+	struct buffer out = { NULL, 0, 0 };
+	*length = 0;
+#ifndef _WIN32
+	if (cbonsaiRun(argc, argv, &out, rows, cols) == 0 && out.data) {
+		*length = out.length;
+		return out.data;
+	}
+#else
+	(void) argc;
+	(void) argv;
+	(void) rows;
+	(void) cols;
+#endif
+	free(out.data);
+	return NULL;
+}
+
 #ifndef CBONSAI_LIBRARY
 int main(int argc, char* argv[]) {
 	return cbonsai_run(argc, argv);
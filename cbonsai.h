@@ -1,6 +1,8 @@
 #ifndef CBONSAI_H
 #define CBONSAI_H
 
+#include <stddef.h>
+
 /*
  * cbonsai library interface
  * Allows other programs to run cbonsai directly without fork/exec
@@ -16,4 +18,18 @@
  */
 int cbonsai_run(int argc, char *argv[]);
 
+/*
+ * Render a tree the way cbonsai's print mode does, into memory instead of
+ * onto the terminal
+ *
+ * argc, argv: as for cbonsai_run; print mode is implied
+ * rows, cols: size of the screen to lay the tree out on, 0 for the terminal's
+ * length: set to the number of bytes rendered
+ *
+ * Returns: ANSI text, a line per screen row, for the caller to free(); NULL
+ * on error, on Windows, or for arguments only cbonsai_run can draw (live,
+ * infinite, verbose or recording)
+ */
+char *cbonsai_render(int argc, char *argv[], int rows, int cols, size_t *length);
+
 #endif /* CBONSAI_H */
@@ -36,6 +36,24 @@ _cbonsai()
     '--save'
     '-C'
     '--load'
+    '-O'
+    '--skip-overdraw'
+    '-B'
+    '--budget'
+    '-j'
+    '--jobs'
+    '-F'
+    '--forest'
+    '-X'
+    '--search'
+    '-N'
+    '--scan'
+    '-R'
+    '--record'
+    '-r'
+    '--replay'
+    '-d'
+    '--diff-render'
     '-v'
     '--verbose'
     '-h'
@@ -43,11 +61,11 @@ _cbonsai()
   )
 
   case "$prev" in
-    -[WC]|--save|--load)
+    -[WCRr]|--save|--load|--record|--replay)
       COMPREPLY=($(compgen -f -- "$cur"))
       return
       ;;
-    -[twmbcMLs]|--time|--wait|--message|--base|--leaf|--multiplier|--life|--seed)
+    -[twmbcMLsBjFXN]|--time|--wait|--message|--base|--leaf|--multiplier|--life|--seed|--budget|--jobs|--forest|--search|--scan)
       return
       ;;
   esac
@@ -0,0 +1,123 @@
+/*
+ * syscall_budget - run a command under ptrace and fail if it makes more
+ * system calls than a budget
+ *
+ * Usage: syscall_budget BUDGET COMMAND [ARGS...]
+ *
+ * Every thread the command starts is followed and counted. Exits 0 within
+ * the budget, 1 over it or if the command fails, and 77 (skipped, to CTest)
+ * where ptrace isn't allowed, as in some containers.
+ *
+ * Linux only.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+
+#define EXIT_SKIP 77
+#define MAX_THREADS 64
+
+// Threads seen, and whether each is stopped inside a syscall (entered, not
+// yet left): syscall stops alternate between entry and exit
+static struct {
+    pid_t tid;
+    int inside;
+} threads[MAX_THREADS];
+static int thread_count = 0;
+
+static int *thread_inside(pid_t tid) {
+    for (int i = 0; i < thread_count; i++) {
+        if (threads[i].tid == tid) return &threads[i].inside;
+    }
+    // a thread that's gone leaves its slot to the next one
+    if (thread_count == MAX_THREADS) thread_count = 0;
+    threads[thread_count].tid = tid;
+    threads[thread_count].inside = 0;
+    return &threads[thread_count++].inside;
+}
+
+static void forget_thread(pid_t tid) {
+    for (int i = 0; i < thread_count; i++) {
+        if (threads[i].tid == tid) threads[i] = threads[--thread_count];
+    }
+}
+
+int main(int argc, char *argv[]) {
+    char *end;
+    long budget = argc > 2 ? strtol(argv[1], &end, 10) : 0;
+    if (argc < 3 || *end || budget <= 0) {
+        fprintf(stderr, "Usage: syscall_budget BUDGET COMMAND [ARGS...]\n");
+        return 2;
+    }
+
+    pid_t child = fork();
+    if (child < 0) {
+        perror("error: fork");
+        return 1;
+    }
+    if (child == 0) {
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0) _exit(EXIT_SKIP);
+        raise(SIGSTOP);
+        execvp(argv[2], argv + 2);
+        fprintf(stderr, "error: can't run '%s': %s\n", argv[2], strerror(errno));
+        _exit(127);
+    }
+
+    int status;
+    if (waitpid(child, &status, 0) != child || !WIFSTOPPED(status)) {
+        if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SKIP) {
+            fprintf(stderr, "syscall_budget: ptrace isn't allowed here, skipped\n");
+            return EXIT_SKIP;
+        }
+        fprintf(stderr, "error: the command didn't start under ptrace\n");
+        return 1;
+    }
+    ptrace(PTRACE_SETOPTIONS, child, NULL,
+           (void *)(long)(PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL));
+    ptrace(PTRACE_SYSCALL, child, NULL, NULL);
+
+    // the stop at exec is the leader's only stop that isn't a syscall's
+    long syscalls = 0;
+    int exit_status = -1;
+    for (;;) {
+        pid_t tid = waitpid(-1, &status, __WALL);
+        if (tid < 0) break;
+
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            forget_thread(tid);
+            if (tid == child) exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            continue;
+        }
+
+        int deliver = 0;
+        int sig = WSTOPSIG(status);
+        if (sig == (SIGTRAP | 0x80)) {
+            int *inside = thread_inside(tid);
+            if (!*inside) syscalls++;
+            *inside = !*inside;
+        } else if (sig == SIGSTOP || sig == SIGTRAP) {
+            // a new thread's first stop, or a clone or exec event
+        } else {
+            deliver = sig;
+        }
+        ptrace(PTRACE_SYSCALL, tid, NULL, (void *)(long)deliver);
+    }
+
+    fprintf(stderr, "syscall_budget: %ld syscalls, budget %ld\n", syscalls, budget);
+    if (exit_status != 0) {
+        fprintf(stderr, "error: '%s' exited with %d\n", argv[2], exit_status);
+        return 1;
+    }
+    if (syscalls > budget) {
+        fprintf(stderr, "error: over budget by %ld; strace -f -c shows where they go\n",
+                syscalls - budget);
+        return 1;
+    }
+    return 0;
+}
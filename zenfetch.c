@@ -11,6 +11,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
 #include <time.h>
 
 #ifdef _WIN32
@@ -46,20 +48,48 @@
     #endif
 #else
     #include <unistd.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <locale.h>
+    #include <pthread.h>
+    #include <signal.h>
     #include <getopt.h>
     #include <sys/utsname.h>
+    #ifdef __linux__
+        #include <sys/sysinfo.h>
+    #endif
     #include <sys/statvfs.h>
     #include <sys/ioctl.h>
+    #include <sys/uio.h>
+    #include <sys/stat.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <poll.h>
     #include <ifaddrs.h>
+    #include <dirent.h>
     #include <netinet/in.h>
     #include <arpa/inet.h>
 #endif
 
+#ifdef ZENFETCH_IO_URING
+    #include <stdint.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <linux/io_uring.h>
+#endif
+
 #include "cbonsai.h"
 
 #define MAX_BUF 512
 #define LABEL_WIDTH 18
 #define BLOCK_WIDTH 70
+#define MAX_LINES 32
+#define MAX_TREE_ROWS 1024  // rows of tree an info block is laid out beside
+#define MIN_TREE_WIDTH 40
+#define STREAM_GRACE_MS 50  // how long the banner waits for every field before streaming
+#define PREFETCH_MAX 32          // files read ahead in one batch
+#define PREFETCH_SIZE 4096       // enough for any of them but cpuinfo
+#define PREFETCH_CPUINFO_SIZE (256 * 1024)
 
 // ANSI color codes
 #define COLOR_RESET   "\033[0m"
@@ -72,18 +102,28 @@ static int noir_mode = 0;
 // Global print mode flag (no animation, instant display)
 static int print_mode = 0;
 
+// Global side by side flag (info beside the tree instead of below it)
+static int beside_mode = 0;
+
+// Global JSON flag (collected values as JSON, no tree)
+static int json_mode = 0;
+
+// Interval of --watch in milliseconds, 0 if not watching
+static long watch_ms = 0;
+
 // Configuration file paths
 #ifdef _WIN32
-    #define CONFIG_LOCATION "C:\\ProgramData\\zenfetch\\location"
-    #define CONFIG_OWNER    "C:\\ProgramData\\zenfetch\\owner"
-    #define CONFIG_SUPPORT  "C:\\ProgramData\\zenfetch\\support"
-    #define CONFIG_DOCS     "C:\\ProgramData\\zenfetch\\docs"
+    #define CONFIG_DIR  "C:\\ProgramData\\zenfetch"
+    #define PATH_SEP    "\\"
 #else
-    #define CONFIG_LOCATION "/etc/zenfetch/location"
-    #define CONFIG_OWNER    "/etc/zenfetch/owner"
-    #define CONFIG_SUPPORT  "/etc/zenfetch/support"
-    #define CONFIG_DOCS     "/etc/zenfetch/docs"
+    #define CONFIG_DIR  "/etc/zenfetch"
+    #define PATH_SEP    "/"
 #endif
+#define CONFIG_FILE     CONFIG_DIR PATH_SEP "config"
+#define CONFIG_DROPINS  CONFIG_DIR PATH_SEP "config.d"
+#define MAX_CONFIG_NAMES 64  // entries of a config directory looked at
+#define MAX_NAME 64
+#define MAX_PATH_LEN 512
 
 static void print_help(void) {
     printf(
@@ -96,123 +136,324 @@ static void print_help(void) {
         "  -L, --location TEXT   set location\n"
         "  -s, --support TEXT    set support contact info\n"
         "  -d, --docs URL        set documentation URL\n"
+        "  -f, --fields LIST     show only these fields, comma separated:\n"
+        "                        hostname os uptime cpu memory storage\n"
+        "                        bandwidth ip location time\n"
         "  -S, --no-support      hide support/docs section\n"
         "  -I, --hide-ip         hide NODE IP field\n"
         "  -n, --noir            noir mode: no colors, bold labels\n"
         "  -p, --print           print mode: no animation, instant display\n"
+        "  -b, --beside          show info beside the tree (print mode)\n"
+        "  -j, --json            print the collected values as JSON, no tree\n"
+#ifndef _WIN32
+        "  -w, --watch INTERVAL  keep memory, uptime, storage, bandwidth and\n"
+        "                        time up to date every INTERVAL (2s, 500ms, 1m)\n"
+#endif
+        "  -P, --prometheus DIR  write the collected values as metrics to\n"
+        "                        DIR/zenfetch.prom, no tree\n"
+#ifndef _WIN32
+        "  -U, --serve SOCKET    serve the metrics on a Unix socket until\n"
+        "                        stopped, collected for every connection\n"
+#endif
         "  -h, --help            show this help\n"
         "\n"
+        "Config files (key = value lines setting owner, location, support,\n"
+        "docs, fields or layout; each file overrides the ones above, CLI\n"
+        "overrides all):\n"
 #ifdef _WIN32
-        "Config files (one value per line, CLI overrides these):\n"
-        "  C:\\ProgramData\\zenfetch\\owner\n"
-        "  C:\\ProgramData\\zenfetch\\location\n"
-        "  C:\\ProgramData\\zenfetch\\support\n"
-        "  C:\\ProgramData\\zenfetch\\docs\n"
+        "  C:\\ProgramData\\zenfetch\\config\n"
+        "  C:\\ProgramData\\zenfetch\\config.d\\*.conf\n"
+        "  %%APPDATA%%\\zenfetch\\config\n"
 #else
-        "Config files (one value per line, CLI overrides these):\n"
-        "  /etc/zenfetch/owner\n"
-        "  /etc/zenfetch/location\n"
-        "  /etc/zenfetch/support\n"
-        "  /etc/zenfetch/docs\n"
+        "  /etc/zenfetch/config\n"
+        "  /etc/zenfetch/config.d/*.conf\n"
+        "  ~/.config/zenfetch/config\n"
 #endif
     );
 }
 
+// Arguments cbonsai draws the tree with, returns how many
+static int cbonsai_args(char *args[]) {
+    int argc = 0;
+    args[argc++] = "cbonsai";
+    if (noir_mode) args[argc++] = "-n";  // noir mode
+    args[argc++] = "-b";
+    args[argc++] = "3";
+    args[argc++] = "-p";                 // print mode
+    if (!print_mode) {
+        args[argc++] = "-l";             // live mode
+        args[argc++] = "-t";
+        args[argc++] = "0.003";          // fast growth
+    }
+    args[argc] = NULL;
+    return argc;
+}
+
 /*
  * Run cbonsai to display the tree
+ *
+ * In print mode the tree is rendered into memory, rows by cols (0 for the
+ * terminal's size), to go out with the rest of the banner. Returns NULL when
+ * cbonsai drew it on the terminal itself.
  */
-static void run_cbonsai(void) {
+static char *run_cbonsai(int rows, int cols, size_t *length) {
+    char *args[10];
+    int argc = cbonsai_args(args);
+    *length = 0;
+
 #ifndef _WIN32
     // Reset getopt for cbonsai's argument parsing
     optind = 1;
 #endif
 
     if (print_mode) {
-        // Print mode: no animation (no -l -t flags)
-        if (noir_mode) {
-            char *args[] = {
-                "cbonsai",
-                "-n",           // noir mode
-                "-b", "3",
-                "-p",           // print mode
-                NULL
-            };
-            cbonsai_run(5, args);
-        } else {
-            char *args[] = {
-                "cbonsai",
-                "-b", "3",
-                "-p",           // print mode
-                NULL
-            };
-            cbonsai_run(4, args);
-        }
-    } else {
-        // Normal mode: with animation
-        if (noir_mode) {
-            char *args[] = {
-                "cbonsai",
-                "-n",           // noir mode
-                "-b", "3",
-                "-p",           // print mode
-                "-l",           // live mode
-                "-t", "0.003",  // fast growth
-                NULL
-            };
-            cbonsai_run(8, args);
-        } else {
-            char *args[] = {
-                "cbonsai",
-                "-b", "3",
-                "-p",           // print mode
-                "-l",           // live mode
-                "-t", "0.003",  // fast growth
-                NULL
-            };
-            cbonsai_run(7, args);
-        }
+        char *tree = cbonsai_render(argc, args, rows, cols, length);
+        if (tree) return tree;
+#ifndef _WIN32
+        optind = 1;
+#endif
     }
+
+    cbonsai_run(argc, args);
+    fflush(stdout);
+    return NULL;
 }
 
-// Get terminal width
-static int get_term_width(void) {
+// Get terminal size
+static void get_term_size(int *width, int *height) {
+    *width = 80;
+    *height = 24;
 #ifdef _WIN32
     CONSOLE_SCREEN_BUFFER_INFO csbi;
     if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
-        return csbi.srWindow.Right - csbi.srWindow.Left + 1;
+        *width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+        *height = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
     }
-    return 80;
 #else
     struct winsize w;
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == -1) {
-        return 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_col > 0 && w.ws_row > 0) {
+        *width = w.ws_col;
+        *height = w.ws_row;
     }
-    return w.ws_col;
 #endif
 }
 
-// Print padding for centering
-static void print_padding(int term_width, int content_width) {
+/*
+ * Output compositor
+ *
+ * The banner is built in memory and written with a single writev(): the
+ * tree cbonsai rendered, the welcome line and the info block. Lines of the
+ * info block are kept apart from how they're placed, so the same block goes
+ * centered below the tree or in a column beside it.
+ */
+struct frame {
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+struct block_line {
+    size_t start;
+    size_t length;
+    int width;       // columns to center the line by, 0 for a blank line
+    unsigned needs;  // fields it still waits for, a bit each
+};
+
+struct block {
+    struct frame text;
+    struct block_line lines[MAX_LINES];
+    int count;
+};
+
+static void frame_append(struct frame *frame, const char *data, size_t length) {
+    if (frame->length + length > frame->capacity) {
+        size_t capacity = frame->capacity ? frame->capacity : 1024;
+        while (frame->length + length > capacity) capacity *= 2;
+        char *data_new = realloc(frame->data, capacity);
+        if (!data_new) return;
+        frame->data = data_new;
+        frame->capacity = capacity;
+    }
+    memcpy(frame->data + frame->length, data, length);
+    frame->length += length;
+}
+
+static void frame_printf(struct frame *frame, const char *format, ...) {
+    char line[MAX_BUF * 4];
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(line, sizeof(line), format, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n >= sizeof(line)) n = (int)sizeof(line) - 1;
+    frame_append(frame, line, (size_t)n);
+}
+
+// Append padding for centering
+static void frame_padding(struct frame *frame, int term_width, int content_width) {
+    static const char spaces[] = "                                                                ";
     int pad = (term_width - content_width) / 2;
-    if (pad < 0) pad = 0;
-    for (int i = 0; i < pad; i++) {
-        putchar(' ');
+    while (pad > 0) {
+        int n = pad < (int)sizeof(spaces) - 1 ? pad : (int)sizeof(spaces) - 1;
+        frame_append(frame, spaces, (size_t)n);
+        pad -= n;
     }
 }
 
-// Print a centered line
-static void print_centered(int term_width, const char *text) {
-    print_padding(term_width, (int)strlen(text));
-    printf("%s\n", text);
+// Write everything out at once, resuming after partial writes
+static void frame_write(const struct frame *frames, int count) {
+#ifdef _WIN32
+    for (int i = 0; i < count; i++) {
+        fwrite(frames[i].data, 1, frames[i].length, stdout);
+    }
+    fflush(stdout);
+#else
+    struct iovec iov[4];
+    int iov_count = 0;
+    for (int i = 0; i < count && iov_count < 4; i++) {
+        if (frames[i].length == 0) continue;
+        iov[iov_count].iov_base = frames[i].data;
+        iov[iov_count].iov_len = frames[i].length;
+        iov_count++;
+    }
+
+    struct iovec *next = iov;
+    while (iov_count > 0) {
+        ssize_t n = writev(STDOUT_FILENO, next, iov_count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        while (iov_count > 0 && (size_t)n >= next->iov_len) {
+            n -= (ssize_t)next->iov_len;
+            next++;
+            iov_count--;
+        }
+        if (iov_count > 0) {
+            next->iov_base = (char *)next->iov_base + n;
+            next->iov_len -= (size_t)n;
+        }
+    }
+#endif
 }
 
-// Print a label-value pair (centered block, left-aligned labels)
-static void print_info(int term_width, const char *label, const char *value) {
-    print_padding(term_width, BLOCK_WIDTH);
-    if (noir_mode) {
-        printf(COLOR_BOLD "%-*s" COLOR_RESET " %s\n", LABEL_WIDTH, label, value);
-    } else {
-        printf(COLOR_CYAN "%-*s" COLOR_RESET " %s\n", LABEL_WIDTH, label, value);
+// Start a new line of the block, returns NULL once it's full
+static struct frame *block_line(struct block *block, int width) {
+    if (block->count == MAX_LINES) return NULL;
+    block->lines[block->count].start = block->text.length;
+    block->lines[block->count].width = width;
+    block->lines[block->count].needs = 0;
+    return &block->text;
+}
+
+static void block_end(struct block *block) {
+    struct block_line *line = &block->lines[block->count++];
+    line->length = block->text.length - line->start;
+}
+
+// Where the block went: centered below the tree, or in a column beside it;
+// the cursor is left on the row after the last one composed
+struct placement {
+    int beside;
+    int term_width;
+    int column;  // beside: column the block starts at
+    int first;   // beside: row of the block's first line
+    int rows;    // rows composed in all
+};
+
+// Append line i of the block, from wherever its row starts
+static void compose_line(struct frame *out, const struct block *block, int i,
+                         const struct placement *place) {
+    const struct block_line *line = &block->lines[i];
+    if (place->beside) {
+        if (!line->width) return;
+        frame_printf(out, COLOR_RESET "\033[%dG", place->column);
+    } else if (line->width) {
+        frame_padding(out, place->term_width, line->width);
+    }
+    frame_append(out, block->text.data + line->start, line->length);
+}
+
+// Lay the block out centered below the tree
+static void compose_below(struct frame *out, const struct block *block, int term_width,
+                          struct placement *place) {
+    memset(place, 0, sizeof(*place));
+    place->term_width = term_width;
+    place->rows = block->count;
+    for (int i = 0; i < block->count; i++) {
+        compose_line(out, block, i, place);
+        frame_append(out, "\n", 1);
+    }
+}
+
+// Whether a row of the rendered tree shows nothing but escape sequences
+static int is_blank_row(const char *row, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (row[i] == '\033') {
+            while (i < length && !isalpha((unsigned char)row[i])) i++;
+        } else if (row[i] != ' ') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Lay the block out in a column beside the tree, vertically centered on it;
+// rows above the tree are left out
+static void compose_beside(struct frame *out, const char *tree, size_t tree_length,
+                           const struct block *block, int column, struct placement *place) {
+    const char *rows[MAX_TREE_ROWS];
+    size_t lengths[MAX_TREE_ROWS];
+    int row_count = 0;
+
+    const char *end = tree + tree_length;
+    for (const char *row = tree; row < end && row_count < MAX_TREE_ROWS; ) {
+        const char *newline = memchr(row, '\n', (size_t)(end - row));
+        if (!newline) newline = end;
+        if (row_count > 0 || !is_blank_row(row, (size_t)(newline - row))) {
+            rows[row_count] = row;
+            lengths[row_count] = (size_t)(newline - row);
+            row_count++;
+        }
+        row = newline + 1;
+    }
+
+    memset(place, 0, sizeof(*place));
+    place->beside = 1;
+    place->column = column;
+    place->first = (row_count - block->count) / 2;
+    if (place->first < 0) place->first = 0;
+    place->rows = row_count > place->first + block->count ? row_count : place->first + block->count;
+
+    for (int y = 0; y < place->rows; y++) {
+        if (y < row_count) frame_append(out, rows[y], lengths[y]);
+        int i = y - place->first;
+        if (i >= 0 && i < block->count) compose_line(out, block, i, place);
+        frame_append(out, "\n", 1);
+    }
+}
+
+// Redraw the lines that changed since the block was composed, in place;
+// lines scrolled off a screen term_height rows tall are left alone
+static void compose_update(struct frame *out, const struct block *old, const struct block *block,
+                           const struct placement *place, int term_height) {
+    for (int i = 0; i < block->count && i < old->count; i++) {
+        const struct block_line *was = &old->lines[i];
+        const struct block_line *line = &block->lines[i];
+        if (was->length == line->length &&
+            memcmp(old->text.data + was->start, block->text.data + line->start, line->length) == 0)
+            continue;
+
+        int up = place->rows - (place->beside ? place->first + i : i);
+        if (up >= term_height) continue;
+        frame_printf(out, "\r\033[%dA", up);
+        if (place->beside) {
+            frame_printf(out, "\033[%dG\033[K", place->column);
+        } else {
+            frame_append(out, "\033[2K", 4);
+        }
+        compose_line(out, block, i, place);
+        frame_printf(out, COLOR_RESET "\r\033[%dB", up);
     }
 }
 
@@ -241,30 +482,235 @@ static int looks_like_url(const char *str) {
     return dot && (!space || dot < space);
 }
 
-// Print a label with a clickable link (OSC 8 hyperlink)
-// Handles URLs (auto-prepends https://) and emails (uses mailto:)
-static void print_link(int term_width, const char *label, const char *url, int is_email) {
-    print_padding(term_width, BLOCK_WIDTH);
-    const char *label_style = noir_mode ? COLOR_BOLD : COLOR_CYAN;
+// Append a value, as a clickable link (OSC 8 hyperlink) if it looks like an
+// email (mailto:) or a URL (https:// unless it has a scheme)
+static void frame_link(struct frame *out, const char *value) {
     // OSC 8 hyperlink: ESC ] 8 ; ; URL BEL text ESC ] 8 ; ; BEL
-    if (is_email) {
-        printf("%s%-*s" COLOR_RESET " \033]8;;mailto:%s\a%s\033]8;;\a\n",
-               label_style, LABEL_WIDTH, label, url, url);
+    if (looks_like_email(value)) {
+        frame_printf(out, "\033]8;;mailto:%s\a%s\033]8;;\a", value, value);
+    } else if (looks_like_url(value)) {
+        int has_scheme = (strncmp(value, "http://", 7) == 0 || strncmp(value, "https://", 8) == 0);
+        frame_printf(out, "\033]8;;%s%s\a%s\033]8;;\a", has_scheme ? "" : "https://", value, value);
     } else {
-        int has_scheme = (strncmp(url, "http://", 7) == 0 || strncmp(url, "https://", 8) == 0);
-        if (has_scheme) {
-            printf("%s%-*s" COLOR_RESET " \033]8;;%s\a%s\033]8;;\a\n",
-                   label_style, LABEL_WIDTH, label, url, url);
-        } else {
-            printf("%s%-*s" COLOR_RESET " \033]8;;https://%s\a%s\033]8;;\a\n",
-                   label_style, LABEL_WIDTH, label, url, url);
+        frame_append(out, value, strlen(value));
+    }
+}
+
+#ifdef ZENFETCH_IO_URING
+// A file read ahead of the collectors
+struct prefetched {
+    char path[128];
+    size_t size;   // room for it in the buffer
+    char *data;
+    size_t length;
+    int fetched;   // data holds the whole file
+    int missing;   // there's no such file
+};
+
+static struct prefetched prefetched[PREFETCH_MAX];
+static int prefetch_count = 0;
+static char *prefetch_buffer = NULL;
+
+// Open and read every file on the list with a single io_uring submission:
+// each open goes straight into a registered file slot and is linked to the
+// read from it. Closing the ring closes the files. Whatever doesn't come
+// back whole is read the usual way later, as is everything if there's no
+// io_uring (kernels before 5.15, or where it's disabled)
+static void prefetch_read(void) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring = (int)syscall(__NR_io_uring_setup, 2 * PREFETCH_MAX, &params);
+    if (ring < 0) return;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    size_t sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && cq_size > sq_size) sq_size = cq_size;
+
+    char *sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring, IORING_OFF_SQ_RING);
+    char *cq = single_mmap ? sq : mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+    struct io_uring_sqe *sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+
+    size_t total = 0;
+    for (int i = 0; i < prefetch_count; i++) total += prefetched[i].size;
+    prefetch_buffer = malloc(total);
+
+    int slots[PREFETCH_MAX];
+    for (int i = 0; i < prefetch_count; i++) slots[i] = -1;
+
+    if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED || !prefetch_buffer ||
+        syscall(__NR_io_uring_register, ring, IORING_REGISTER_FILES, slots, prefetch_count) < 0)
+        goto done;
+
+    unsigned *sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    unsigned sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    unsigned *sq_array = (unsigned *)(sq + params.sq_off.array);
+    unsigned tail = *sq_tail;
+    char *data = prefetch_buffer;
+
+    for (int i = 0; i < prefetch_count; i++) {
+        struct prefetched *file = &prefetched[i];
+        file->data = data;
+        data += file->size;
+
+        struct io_uring_sqe *opening = &sqes[2 * i];
+        memset(opening, 0, sizeof(*opening));
+        opening->opcode = IORING_OP_OPENAT;
+        opening->flags = IOSQE_IO_LINK;
+        opening->fd = AT_FDCWD;
+        opening->addr = (uintptr_t)file->path;
+        opening->open_flags = O_RDONLY;  // no O_CLOEXEC, it never gets a descriptor
+        opening->file_index = i + 1;
+        opening->user_data = 2 * i;
+
+        struct io_uring_sqe *reading = &sqes[2 * i + 1];
+        memset(reading, 0, sizeof(*reading));
+        reading->opcode = IORING_OP_READ;
+        reading->flags = IOSQE_FIXED_FILE;
+        reading->fd = i;
+        reading->addr = (uintptr_t)file->data;
+        reading->len = (unsigned)file->size;
+        reading->user_data = 2 * i + 1;
+
+        sq_array[(tail + 2 * i) & sq_mask] = 2 * i;
+        sq_array[(tail + 2 * i + 1) & sq_mask] = 2 * i + 1;
+    }
+    __atomic_store_n(sq_tail, tail + 2 * prefetch_count, __ATOMIC_RELEASE);
+
+    int pending = (int)syscall(__NR_io_uring_enter, ring, 2 * prefetch_count,
+                               2 * prefetch_count, IORING_ENTER_GETEVENTS, NULL, 0);
+
+    unsigned *cq_head = (unsigned *)(cq + params.cq_off.head);
+    unsigned *cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    unsigned cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    struct io_uring_cqe *cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    while (pending > 0) {
+        unsigned head = *cq_head;
+        unsigned ready = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        if (head == ready) {
+            if (syscall(__NR_io_uring_enter, ring, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+                errno != EINTR)
+                break;
+            continue;
+        }
+
+        for (; head != ready; head++, pending--) {
+            const struct io_uring_cqe *cqe = &cqes[head & cq_mask];
+            struct prefetched *file = &prefetched[cqe->user_data / 2];
+            if (cqe->user_data % 2 == 0) {
+                file->missing = cqe->res == -ENOENT;
+            } else if (cqe->res >= 0 && (size_t)cqe->res < file->size) {
+                // A full buffer might not be the whole file
+                file->length = (size_t)cqe->res;
+                file->fetched = 1;
+            }
         }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
     }
+
+done:
+    if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+    if (cq != MAP_FAILED && !single_mmap) munmap(cq, cq_size);
+    if (sq != MAP_FAILED) munmap(sq, sq_size);
+    close(ring);
+}
+#endif
+
+#ifndef _WIN32
+// Files kept open while watching, read again from the start every tick
+#define KEPT_MAX 32
+#define KEPT_SIZE 4096
+#define KEPT_RETRY 30   // opens of an unreadable file before it's tried again
+#define KEPT_TOO_BIG -2 // fd of a file that doesn't fit, opened every time
+
+static struct kept_file {
+    char path[128];
+    int fd;     // -1 while it's unreadable
+    int retry;
+    char data[KEPT_SIZE];
+} kept_files[KEPT_MAX];
+static int kept_count = 0;
+static int keep_files = 0;  // set once --watch starts ticking
+
+// Open a file to read with pread() from a descriptor kept open for it. One
+// that's missing or won't read (a link speed of a virtual interface, one
+// that's gone) is only looked at again every KEPT_RETRY times
+static FILE *open_kept(const char *path) {
+    struct kept_file *file = NULL;
+    for (int i = 0; i < kept_count && !file; i++) {
+        if (strcmp(kept_files[i].path, path) == 0) file = &kept_files[i];
+    }
+    if (!file) {
+        if (kept_count == KEPT_MAX || strlen(path) >= sizeof(file->path)) return fopen(path, "r");
+        file = &kept_files[kept_count++];
+        memcpy(file->path, path, strlen(path) + 1);
+        file->fd = -1;
+        file->retry = 0;
+    }
+    if (file->fd == KEPT_TOO_BIG) return fopen(path, "r");
+
+    if (file->fd < 0) {
+        if (file->retry > 0) {
+            file->retry--;
+            errno = ENOENT;
+            return NULL;
+        }
+        file->fd = open(path, O_RDONLY | O_CLOEXEC);
+    }
+    ssize_t length = file->fd < 0 ? -1 : pread(file->fd, file->data, sizeof(file->data), 0);
+    if (length > 0 && (size_t)length == sizeof(file->data)) {
+        close(file->fd);
+        file->fd = KEPT_TOO_BIG;
+        return fopen(path, "r");
+    }
+    if (length <= 0) {
+        if (file->fd >= 0) close(file->fd);
+        file->fd = -1;
+        file->retry = KEPT_RETRY;
+        return NULL;
+    }
+    return fmemopen(file->data, (size_t)length, "r");
+}
+
+static void kept_close(void) {
+    for (int i = 0; i < kept_count; i++) {
+        if (kept_files[i].fd >= 0) close(kept_files[i].fd);
+    }
+    kept_count = 0;
+    keep_files = 0;
+}
+#endif
+
+// Open a file to read, from what was fetched ahead of time if it's there
+static FILE *open_file(const char *path) {
+#ifndef _WIN32
+    if (keep_files) return open_kept(path);
+#endif
+#ifdef ZENFETCH_IO_URING
+    for (int i = 0; i < prefetch_count; i++) {
+        if (strcmp(prefetched[i].path, path) != 0) continue;
+        if (prefetched[i].missing) {
+            errno = ENOENT;
+            return NULL;
+        }
+        if (prefetched[i].fetched && prefetched[i].length > 0) {
+            FILE *f = fmemopen(prefetched[i].data, prefetched[i].length, "r");
+            if (f) return f;
+        }
+        break;
+    }
+#endif
+    return fopen(path, "r");
 }
 
 // Read a line from a file
 static int read_file_line(const char *path, char *buf, size_t size) {
-    FILE *f = fopen(path, "r");
+    FILE *f = open_file(path);
     if (!f) return -1;
     if (fgets(buf, (int)size, f) == NULL) {
         fclose(f);
@@ -275,6 +721,18 @@ static int read_file_line(const char *path, char *buf, size_t size) {
     return 0;
 }
 
+// Read a whole file, NUL terminated
+static int read_file(const char *path, struct frame *out) {
+    FILE *f = open_file(path);
+    if (!f) return -1;
+    char chunk[4096];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof(chunk), f)) > 0) frame_append(out, chunk, length);
+    fclose(f);
+    frame_append(out, "", 1);
+    return 0;
+}
+
 // Read from config file with fallback
 static void read_config(const char *path, char *buf, size_t size, const char *fallback) {
     if (read_file_line(path, buf, size) != 0) {
@@ -283,8 +741,184 @@ static void read_config(const char *path, char *buf, size_t size, const char *fa
     }
 }
 
+// Everything the config can set
+struct settings {
+    char location[MAX_BUF], owner[MAX_BUF];
+    char support[MAX_BUF], docs[MAX_BUF];
+    char fields[MAX_BUF];
+    char layout[MAX_BUF];  // path of a layout template
+};
+
+// The keys setting them; the first few also had one-value files of their own
+static const struct {
+    const char *key;
+    size_t offset;
+    int legacy;
+} setting_keys[] = {
+    {"location", offsetof(struct settings, location), 1},
+    {"owner",    offsetof(struct settings, owner),    1},
+    {"support",  offsetof(struct settings, support),  1},
+    {"docs",     offsetof(struct settings, docs),     1},
+    {"fields",   offsetof(struct settings, fields),   1},
+    {"layout",   offsetof(struct settings, layout),   0},
+};
+
+// Where the value of key goes, NULL if there's no such key (or no such
+// legacy file)
+static char *setting(struct settings *settings, const char *key, size_t length, int legacy) {
+    for (size_t i = 0; i < sizeof(setting_keys) / sizeof(setting_keys[0]); i++) {
+        if (strlen(setting_keys[i].key) == length && strncmp(setting_keys[i].key, key, length) == 0 &&
+            (setting_keys[i].legacy || !legacy))
+            return (char *)settings + setting_keys[i].offset;
+    }
+    return NULL;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+// Names in a directory, sorted; returns how many, -1 if it can't be read
+static int list_dir(const char *path, char names[][MAX_NAME], int max) {
+    int count = 0;
+#ifdef _WIN32
+    char pattern[MAX_PATH_LEN];
+    snprintf(pattern, sizeof(pattern), "%s\\*", path);
+    WIN32_FIND_DATAA entry;
+    HANDLE dir = FindFirstFileA(pattern, &entry);
+    if (dir == INVALID_HANDLE_VALUE) return -1;
+    do {
+        if (count < max && strlen(entry.cFileName) < MAX_NAME)
+            strcpy(names[count++], entry.cFileName);
+    } while (FindNextFileA(dir, &entry));
+    FindClose(dir);
+#else
+    DIR *dir = opendir(path);
+    if (!dir) return -1;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (count < max && strlen(entry->d_name) < MAX_NAME)
+            strcpy(names[count++], entry->d_name);
+    }
+    closedir(dir);
+#endif
+    qsort(names, (size_t)count, sizeof(names[0]), compare_names);
+    return count;
+}
+
+// Path of the user's own config, 0 if there's no telling where it is
+static int user_config_path(char *path, size_t size) {
+#ifdef _WIN32
+    const char *appdata = getenv("APPDATA");
+    if (!appdata || !*appdata) return 0;
+    snprintf(path, size, "%s\\zenfetch\\config", appdata);
+#else
+    const char *config_home = getenv("XDG_CONFIG_HOME");
+    const char *home = getenv("HOME");
+    if (config_home && *config_home) {
+        snprintf(path, size, "%s/zenfetch/config", config_home);
+    } else if (home && *home) {
+        snprintf(path, size, "%s/.config/zenfetch/config", home);
+    } else {
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+// Read key = value lines over the settings so far. Blank lines, comments
+// (#) and keys zenfetch doesn't know are skipped
+static void read_config_file(const char *path, struct settings *settings) {
+    FILE *f = open_file(path);
+    if (!f) return;
+
+    char line[MAX_BUF + MAX_NAME];
+    while (fgets(line, sizeof(line), f)) {
+        char *key = line + strspn(line, " \t");
+        char *equals = strchr(key, '=');
+        if (*key == '#' || !equals) continue;
+
+        char *key_end = equals;
+        while (key_end > key && (key_end[-1] == ' ' || key_end[-1] == '\t')) key_end--;
+        char *value = equals + 1 + strspn(equals + 1, " \t");
+        size_t length = strcspn(value, "\r\n");
+        while (length > 0 && (value[length - 1] == ' ' || value[length - 1] == '\t')) length--;
+        value[length] = 0;
+
+        char *dest = setting(settings, key, (size_t)(key_end - key), 0);
+        if (dest) snprintf(dest, MAX_BUF, "%s", value);
+    }
+    fclose(f);
+}
+
+// Read the whole config in one pass: the old one-value files, the config
+// file, the drop-ins in config.d in name order, then the user's config,
+// each over what came before. Only what the config directory lists is
+// opened, so a host with no config pays for one failed open
+static void read_settings(struct settings *settings) {
+    memset(settings, 0, sizeof(*settings));
+
+    char names[MAX_CONFIG_NAMES][MAX_NAME];
+    char path[MAX_PATH_LEN];
+    int has_file = 0, has_dropins = 0;
+    int count = list_dir(CONFIG_DIR, names, MAX_CONFIG_NAMES);
+    for (int i = 0; i < count; i++) {
+        char *legacy = setting(settings, names[i], strlen(names[i]), 1);
+        if (legacy) {
+            snprintf(path, sizeof(path), "%s" PATH_SEP "%s", CONFIG_DIR, names[i]);
+            read_config(path, legacy, MAX_BUF, "");
+        }
+        has_file |= strcmp(names[i], "config") == 0;
+        has_dropins |= strcmp(names[i], "config.d") == 0;
+    }
+
+    if (has_file) read_config_file(CONFIG_FILE, settings);
+
+    count = has_dropins ? list_dir(CONFIG_DROPINS, names, MAX_CONFIG_NAMES) : 0;
+    for (int i = 0; i < count; i++) {
+        size_t length = strlen(names[i]);
+        if (length <= 5 || strcmp(names[i] + length - 5, ".conf") != 0) continue;
+        snprintf(path, sizeof(path), "%s" PATH_SEP "%s", CONFIG_DROPINS, names[i]);
+        read_config_file(path, settings);
+    }
+
+    if (user_config_path(path, sizeof(path))) read_config_file(path, settings);
+}
+
+// The numbers and strings behind what a collector shows, for --json
+struct raw_value {
+    const char *name;
+    int is_text;
+    long long number;
+    char text[128];
+};
+
+#define MAX_RAW 4
+
+struct raw_values {
+    const char *error;  // why the field is unknown, if it is
+    int count;
+    struct raw_value values[MAX_RAW];
+};
+
+static void raw_number(struct raw_values *raw, const char *name, long long number) {
+    if (raw->count == MAX_RAW) return;
+    struct raw_value *value = &raw->values[raw->count++];
+    value->name = name;
+    value->is_text = 0;
+    value->number = number;
+}
+
+static void raw_text(struct raw_values *raw, const char *name, const char *text) {
+    if (raw->count == MAX_RAW) return;
+    struct raw_value *value = &raw->values[raw->count++];
+    value->name = name;
+    value->is_text = 1;
+    snprintf(value->text, sizeof(value->text), "%s", text);
+}
+
 // Get CPU model name and core count
-static void get_cpu_info(char *buf, size_t size) {
+static void get_cpu_info(char *buf, size_t size, struct raw_values *raw) {
 #ifdef _WIN32
     HKEY hKey;
     char cpu_name[256] = "Unknown";
@@ -308,10 +942,13 @@ static void get_cpu_info(char *buf, size_t size) {
     while (*trimmed == ' ') trimmed++;
 
     snprintf(buf, size, "%s %d core", trimmed, cores);
+    raw_text(raw, "model", trimmed);
+    raw_number(raw, "cores", cores);
 #else
-    FILE *f = fopen("/proc/cpuinfo", "r");
+    FILE *f = open_file("/proc/cpuinfo");
     if (!f) {
         snprintf(buf, size, "Unknown");
+        raw->error = "can't read /proc/cpuinfo";
         return;
     }
 
@@ -336,11 +973,13 @@ static void get_cpu_info(char *buf, size_t size) {
     fclose(f);
 
     snprintf(buf, size, "%s %d core", model, cores);
+    raw_text(raw, "model", model);
+    raw_number(raw, "cores", cores);
 #endif
 }
 
 // Get memory info
-static void get_memory_info(char *buf, size_t size) {
+static void get_memory_info(char *buf, size_t size, struct raw_values *raw) {
 #ifdef _WIN32
     MEMORYSTATUSEX memInfo;
     memInfo.dwLength = sizeof(MEMORYSTATUSEX);
@@ -350,32 +989,52 @@ static void get_memory_info(char *buf, size_t size) {
         unsigned long long avail = memInfo.ullAvailPhys / (1024 * 1024);
         unsigned long long used = total - avail;
         snprintf(buf, size, "%llu MB / %llu MB", used, total);
+        raw_number(raw, "total_bytes", (long long)memInfo.ullTotalPhys);
+        raw_number(raw, "available_bytes", (long long)memInfo.ullAvailPhys);
+        raw_number(raw, "used_bytes", (long long)(memInfo.ullTotalPhys - memInfo.ullAvailPhys));
     } else {
         snprintf(buf, size, "Unknown");
+        raw->error = "GlobalMemoryStatusEx() failed";
     }
 #else
-    FILE *f = fopen("/proc/meminfo", "r");
-    if (!f) {
+    unsigned long total = 0, available = 0;
+    FILE *f = open_file("/proc/meminfo");
+    if (f) {
+        char line[256];
+        while (fgets(line, sizeof(line), f)) {
+            sscanf(line, "MemTotal: %lu kB", &total);
+            sscanf(line, "MemAvailable: %lu kB", &available);
+        }
+        fclose(f);
+    } else {
+#ifdef __linux__
+        // Without /proc (chroots, some containers) sysinfo() still knows,
+        // though free and buffer memory is the nearest it has to available
+        struct sysinfo si;
+        if (sysinfo(&si) != 0) {
+            snprintf(buf, size, "Unknown");
+            raw->error = "can't read /proc/meminfo, and sysinfo() failed";
+            return;
+        }
+        total = (unsigned long)((unsigned long long)si.totalram * si.mem_unit / 1024);
+        available = (unsigned long)((unsigned long long)(si.freeram + si.bufferram) * si.mem_unit / 1024);
+#else
         snprintf(buf, size, "Unknown");
+        raw->error = "can't read /proc/meminfo";
         return;
+#endif
     }
 
-    char line[256];
-    unsigned long total = 0, available = 0;
-
-    while (fgets(line, sizeof(line), f)) {
-        sscanf(line, "MemTotal: %lu kB", &total);
-        sscanf(line, "MemAvailable: %lu kB", &available);
-    }
-    fclose(f);
-
     unsigned long used = total - available;
     snprintf(buf, size, "%lu MB / %lu MB", used / 1024, total / 1024);
+    raw_number(raw, "total_bytes", (long long)total * 1024);
+    raw_number(raw, "available_bytes", (long long)available * 1024);
+    raw_number(raw, "used_bytes", (long long)used * 1024);
 #endif
 }
 
 // Get storage info for root partition
-static void get_storage_info(char *buf, size_t size) {
+static void get_storage_info(char *buf, size_t size, struct raw_values *raw) {
 #ifdef _WIN32
     ULARGE_INTEGER freeBytesAvailable, totalBytes, totalFreeBytes;
 
@@ -383,13 +1042,18 @@ static void get_storage_info(char *buf, size_t size) {
         double total_gb = (double)totalBytes.QuadPart / (1024.0 * 1024.0 * 1024.0);
         double avail_gb = (double)freeBytesAvailable.QuadPart / (1024.0 * 1024.0 * 1024.0);
         snprintf(buf, size, "%.1fG / %.1fG", avail_gb, total_gb);
+        raw_text(raw, "mountpoint", "C:\\");
+        raw_number(raw, "total_bytes", (long long)totalBytes.QuadPart);
+        raw_number(raw, "available_bytes", (long long)freeBytesAvailable.QuadPart);
     } else {
         snprintf(buf, size, "Unknown");
+        raw->error = "GetDiskFreeSpaceEx() failed";
     }
 #else
     struct statvfs stat;
     if (statvfs("/", &stat) != 0) {
         snprintf(buf, size, "Unknown");
+        raw->error = "statvfs() of / failed";
         return;
     }
 
@@ -400,11 +1064,24 @@ static void get_storage_info(char *buf, size_t size) {
     double avail_gb = avail / (1024.0 * 1024.0 * 1024.0);
 
     snprintf(buf, size, "%.1fG / %.1fG", avail_gb, total_gb);
+    raw_text(raw, "mountpoint", "/");
+    raw_number(raw, "total_bytes", (long long)total);
+    raw_number(raw, "available_bytes", (long long)avail);
 #endif
 }
 
+#ifndef _WIN32
+// Common interface names to check for a link speed
+static const char *const net_interfaces[] = {
+    "eth0", "eth1",
+    "enp0s31f6", "enp0s25", "eno1", "eno2",
+    "wlan0", "wlp0s20f3", "wlp2s0",
+    NULL
+};
+#endif
+
 // Get network bandwidth (link speed)
-static void get_network_bandwidth(char *buf, size_t size) {
+static void get_network_bandwidth(char *buf, size_t size, struct raw_values *raw) {
 #ifdef _WIN32
     ULONG outBufLen = 15000;
     PIP_ADAPTER_ADDRESSES pAddresses = NULL;
@@ -463,6 +1140,8 @@ static void get_network_bandwidth(char *buf, size_t size) {
                     }
                     snprintf(buf, size, "%llu Mbps (%s)",
                              (unsigned long long)(speed / 1000000), type);
+                    raw_number(raw, "speed_mbps", (long long)(speed / 1000000));
+                    raw_text(raw, "type", type);
                     free(pAddresses);
                     return;
                 }
@@ -473,46 +1152,43 @@ static void get_network_bandwidth(char *buf, size_t size) {
 
     free(pAddresses);
     snprintf(buf, size, "Unknown");
+    raw->error = "no connected adapter reports a link speed";
 #else
     char speed_path[128];
     char state_path[128];
     char speed[32];
     char state[32];
 
-    // Common interface names to check
-    const char *interfaces[] = {
-        "eth0", "eth1",
-        "enp0s31f6", "enp0s25", "eno1", "eno2",
-        "wlan0", "wlp0s20f3", "wlp2s0",
-        NULL
-    };
-
-    for (int i = 0; interfaces[i] != NULL; i++) {
+    for (int i = 0; net_interfaces[i] != NULL; i++) {
         snprintf(state_path, sizeof(state_path),
-                 "/sys/class/net/%s/operstate", interfaces[i]);
+                 "/sys/class/net/%s/operstate", net_interfaces[i]);
 
         if (read_file_line(state_path, state, sizeof(state)) == 0 &&
             strcmp(state, "up") == 0) {
 
             snprintf(speed_path, sizeof(speed_path),
-                     "/sys/class/net/%s/speed", interfaces[i]);
+                     "/sys/class/net/%s/speed", net_interfaces[i]);
 
             if (read_file_line(speed_path, speed, sizeof(speed)) == 0) {
                 int spd = atoi(speed);
                 if (spd > 0) {
-                    const char *type = (interfaces[i][0] == 'w') ? "Wi-Fi" : "Ethernet";
+                    const char *type = (net_interfaces[i][0] == 'w') ? "Wi-Fi" : "Ethernet";
                     snprintf(buf, size, "%d Mbps (%s)", spd, type);
+                    raw_number(raw, "speed_mbps", spd);
+                    raw_text(raw, "type", type);
+                    raw_text(raw, "interface", net_interfaces[i]);
                     return;
                 }
             }
         }
     }
     snprintf(buf, size, "Unknown");
+    raw->error = "no known interface is up with a link speed";
 #endif
 }
 
 // Get primary IP address
-static void get_ip_address(char *buf, size_t size) {
+static void get_ip_address(char *buf, size_t size, struct raw_values *raw) {
 #ifdef _WIN32
     ULONG outBufLen = 15000;
     PIP_ADAPTER_ADDRESSES pAddresses = NULL;
@@ -548,6 +1224,7 @@ static void get_ip_address(char *buf, size_t size) {
                 if (pUnicast != NULL) {
                     struct sockaddr_in *sa_in = (struct sockaddr_in *)pUnicast->Address.lpSockaddr;
                     inet_ntop(AF_INET, &(sa_in->sin_addr), buf, (socklen_t)size);
+                    raw_text(raw, "address", buf);
                     free(pAddresses);
                     return;
                 }
@@ -558,11 +1235,13 @@ static void get_ip_address(char *buf, size_t size) {
 
     free(pAddresses);
     snprintf(buf, size, "127.0.0.1");
+    raw_text(raw, "address", buf);
 #else
     struct ifaddrs *ifaddr, *ifa;
 
     if (getifaddrs(&ifaddr) == -1) {
         snprintf(buf, size, "Unknown");
+        raw->error = "getifaddrs() failed";
         return;
     }
 
@@ -573,19 +1252,28 @@ static void get_ip_address(char *buf, size_t size) {
 
         struct sockaddr_in *addr = (struct sockaddr_in *)ifa->ifa_addr;
         inet_ntop(AF_INET, &addr->sin_addr, buf, (socklen_t)size);
+        raw_text(raw, "address", buf);
+        raw_text(raw, "interface", ifa->ifa_name);
         freeifaddrs(ifaddr);
         return;
     }
 
     freeifaddrs(ifaddr);
     snprintf(buf, size, "127.0.0.1");
+    raw_text(raw, "address", buf);
 #endif
 }
 
 // Get local time
-static void get_local_time(char *buf, size_t size) {
+static void get_local_time(char *buf, size_t size, struct raw_values *raw) {
     time_t now = time(NULL);
+#ifdef _WIN32
     struct tm *tm_info = localtime(&now);
+#else
+    struct tm tm_now;
+    struct tm *tm_info = localtime_r(&now, &tm_now);
+#endif
+    raw_number(raw, "epoch_seconds", (long long)now);
 #ifdef _WIN32
     // Windows doesn't have %Z that works reliably, use TIME_ZONE_INFORMATION instead
     TIME_ZONE_INFORMATION tz;
@@ -596,13 +1284,15 @@ static void get_local_time(char *buf, size_t size) {
     char time_part[128];
     strftime(time_part, sizeof(time_part), "%B %d %Y, %I:%M:%S %p", tm_info);
     snprintf(buf, size, "%s %s", time_part, tz_name);
+    raw_number(raw, "utc_offset_seconds", -(long long)tz.Bias * 60);
 #else
     strftime(buf, size, "%B %d %Y, %I:%M:%S %p %Z", tm_info);
+    raw_number(raw, "utc_offset_seconds", tm_info->tm_gmtoff);
 #endif
 }
 
 // Get OS info
-static void get_os_info(char *buf, size_t size) {
+static void get_os_info(char *buf, size_t size, struct raw_values *raw) {
 #ifdef _WIN32
     // Use RtlGetVersion via ntdll for accurate version info
     typedef LONG (WINAPI *RtlGetVersionPtr)(PRTL_OSVERSIONINFOW);
@@ -631,9 +1321,11 @@ static void get_os_info(char *buf, size_t size) {
     }
 
     snprintf(buf, size, "%s (Build %lu)", win_name, osvi.dwBuildNumber);
+    raw_text(raw, "name", win_name);
+    raw_number(raw, "build", (long long)osvi.dwBuildNumber);
 #else
     char pretty_name[256] = "";
-    FILE *f = fopen("/etc/os-release", "r");
+    FILE *f = open_file("/etc/os-release");
 
     if (f) {
         char line[256];
@@ -659,22 +1351,27 @@ static void get_os_info(char *buf, size_t size) {
         } else {
             snprintf(buf, size, "%s %s", uts.sysname, uts.release);
         }
+        raw_text(raw, "name", strlen(pretty_name) > 0 ? pretty_name : uts.sysname);
+        raw_text(raw, "kernel", uts.release);
     } else {
         snprintf(buf, size, "Unknown");
+        raw->error = "uname() failed";
     }
 #endif
 }
 
 // Get hostname
-static void get_hostname(char *buf, size_t size) {
+static void get_hostname(char *buf, size_t size, struct raw_values *raw) {
 #ifdef _WIN32
     DWORD buf_size = (DWORD)size;
     if (!GetComputerNameA(buf, &buf_size)) {
         snprintf(buf, size, "unknown");
+        raw->error = "GetComputerName() failed";
     }
 #else
     if (gethostname(buf, size) != 0) {
         snprintf(buf, size, "unknown");
+        raw->error = "gethostname() failed";
     }
 #endif
 }
@@ -696,10 +1393,11 @@ static void lowercase(char *str) {
 }
 
 // Get uptime
-static void get_uptime(char *buf, size_t size) {
+static void get_uptime(char *buf, size_t size, struct raw_values *raw) {
 #ifdef _WIN32
     ULONGLONG uptime_ms = GetTickCount64();
     double uptime_secs = (double)uptime_ms / 1000.0;
+    raw_number(raw, "seconds", (long long)(uptime_ms / 1000));
 
     int days = (int)(uptime_secs / 86400);
     int hours = (int)((uptime_secs - days * 86400) / 3600);
@@ -713,19 +1411,38 @@ static void get_uptime(char *buf, size_t size) {
         snprintf(buf, size, "%dm", mins);
     }
 #else
-    FILE *f = fopen("/proc/uptime", "r");
+    double uptime_secs;
+#ifdef __linux__
+    // The boot clock is what /proc/uptime shows, and reading it usually
+    // takes no syscall at all; sysinfo() has it too, in whole seconds
+    struct timespec boot;
+    struct sysinfo si;
+    if (clock_gettime(CLOCK_BOOTTIME, &boot) == 0) {
+        uptime_secs = (double)boot.tv_sec + boot.tv_nsec / 1e9;
+    } else if (sysinfo(&si) == 0) {
+        uptime_secs = (double)si.uptime;
+    } else {
+        snprintf(buf, size, "Unknown");
+        raw->error = "sysinfo() failed";
+        return;
+    }
+#else
+    FILE *f = open_file("/proc/uptime");
     if (!f) {
         snprintf(buf, size, "Unknown");
+        raw->error = "can't read /proc/uptime";
         return;
     }
 
-    double uptime_secs;
     if (fscanf(f, "%lf", &uptime_secs) != 1) {
         fclose(f);
         snprintf(buf, size, "Unknown");
+        raw->error = "can't read /proc/uptime";
         return;
     }
     fclose(f);
+#endif
+    raw_number(raw, "seconds", (long long)uptime_secs);
 
     int days = (int)(uptime_secs / 86400);
     int hours = (int)((uptime_secs - days * 86400) / 3600);
@@ -741,12 +1458,1019 @@ static void get_uptime(char *buf, size_t size) {
 #endif
 }
 
+// Hostname as the welcome message shows it
+static void get_welcome_hostname(char *buf, size_t size, struct raw_values *raw) {
+    get_hostname(buf, size, raw);
+    lowercase(buf);
+}
+
+// How long a collector may take: fields are collected cheapest first, so
+// they show up while slow ones are still running
+enum cost {
+    COST_CHEAP,  // a syscall or a small /proc file
+    COST_IO,     // walks devices or interfaces
+    COST_SLOW,   // may block on a filesystem or the network
+    COST_CLASSES
+};
+
+#define PLATFORM_UNIX    1
+#define PLATFORM_WINDOWS 2
+#define PLATFORM_ANY     (PLATFORM_UNIX | PLATFORM_WINDOWS)
+
+#ifdef _WIN32
+    #define THIS_PLATFORM PLATFORM_WINDOWS
+#else
+    #define THIS_PLATFORM PLATFORM_UNIX
+#endif
+
+struct collector {
+    const char *name;   // what --fields and the fields config call it
+    const char *label;  // NULL if it isn't a line of the info block
+    enum cost cost;
+    int platforms;      // where it runs
+    int live;           // changes while zenfetch runs, so --watch collects it again
+    void (*collect)(char *buf, size_t size, struct raw_values *raw);  // NULL for the configured location
+};
+
+// Every field zenfetch knows, in the order the info block shows them; a
+// site-specific collector only needs an entry here
+static const struct collector collectors[] = {
+    {"hostname",  NULL,                COST_CHEAP, PLATFORM_ANY, 0, get_welcome_hostname},
+    {"os",        "OS",                COST_CHEAP, PLATFORM_ANY, 0, get_os_info},
+    {"uptime",    "UPTIME",            COST_CHEAP, PLATFORM_ANY, 1, get_uptime},
+    {"cpu",       "HARDWARE",          COST_IO,    PLATFORM_ANY, 0, get_cpu_info},
+    {"memory",    "MEMORY",            COST_CHEAP, PLATFORM_ANY, 1, get_memory_info},
+    {"storage",   "STORAGE",           COST_SLOW,  PLATFORM_ANY, 1, get_storage_info},
+    {"bandwidth", "NETWORK BANDWIDTH", COST_IO,    PLATFORM_ANY, 1, get_network_bandwidth},
+    {"ip",        "NODE IP",           COST_IO,    PLATFORM_ANY, 0, get_ip_address},
+    {"location",  "LOCATION",          COST_CHEAP, PLATFORM_ANY, 0, NULL},
+    {"time",      "LOCAL TIME",        COST_CHEAP, PLATFORM_ANY, 1, get_local_time},
+};
+
+#define FIELD_COUNT ((int)(sizeof(collectors) / sizeof(collectors[0])))
+#define FIELD(i) (1u << (i))
+#define ALL_FIELDS (~0u >> (32 - FIELD_COUNT))
+#define PENDING "..."
+
+// Fields are bits of an unsigned mask
+typedef char field_count_fits_mask[FIELD_COUNT <= 32 ? 1 : -1];
+
+// Index of the field called name, -1 if there's none
+static int find_field(const char *name, size_t length) {
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (strlen(collectors[i].name) == length && strncmp(collectors[i].name, name, length) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// Parse a comma separated list of field names into a mask; returns -1 and
+// complains about the first name it doesn't know
+static int parse_fields(const char *list, unsigned *fields) {
+    *fields = 0;
+    while (*list) {
+        size_t length = strcspn(list, ", ");
+        if (length > 0) {
+            int field = find_field(list, length);
+            if (field < 0) {
+                printf("error: unknown field: '%.*s'\n", (int)length, list);
+                return -1;
+            }
+            *fields |= FIELD(field);
+        }
+        list += length;
+        while (*list == ',' || *list == ' ') list++;
+    }
+    return 0;
+}
+
+// Parse an interval like 2s, 500ms or 1m (seconds if there's no unit) into
+// milliseconds; -1 if it isn't one
+static long parse_interval(const char *text) {
+    char *unit;
+    long value = strtol(text, &unit, 10);
+    long scale = strcmp(unit, "ms") == 0 ? 1 :
+                 strcmp(unit, "s") == 0 || !*unit ? 1000 :
+                 strcmp(unit, "m") == 0 ? 60000 : 0;
+    if (unit == text || value <= 0 || !scale || value > 86400000L / scale) {
+        printf("error: bad interval: '%s'\n", text);
+        return -1;
+    }
+    return value * scale;
+}
+
+#ifdef ZENFETCH_IO_URING
+// What the collectors of fields read besides the interfaces' link state
+static const struct {
+    const char *field;
+    const char *path;
+    size_t size;
+} field_files[] = {
+    {"os",     "/etc/os-release", PREFETCH_SIZE},
+    {"cpu",    "/proc/cpuinfo",   PREFETCH_CPUINFO_SIZE},
+    {"memory", "/proc/meminfo",   PREFETCH_SIZE},
+};
+
+static void prefetch_add(const char *path, size_t size) {
+    if (prefetch_count == PREFETCH_MAX || strlen(path) >= sizeof(prefetched[0].path)) return;
+    struct prefetched *file = &prefetched[prefetch_count++];
+    snprintf(file->path, sizeof(file->path), "%s", path);
+    file->size = size;
+}
+#endif
+
+// Read the config and what the collectors of the fields will read in one
+// batch, if there's a way to; the config may still leave some fields out
+static void prefetch_files(unsigned fields) {
+#ifdef ZENFETCH_IO_URING
+    char path[MAX_PATH_LEN];
+    prefetch_add(CONFIG_FILE, PREFETCH_SIZE);
+    if (user_config_path(path, sizeof(path))) prefetch_add(path, PREFETCH_SIZE);
+
+    for (size_t i = 0; i < sizeof(field_files) / sizeof(field_files[0]); i++) {
+        int field = find_field(field_files[i].field, strlen(field_files[i].field));
+        if (fields & FIELD(field)) prefetch_add(field_files[i].path, field_files[i].size);
+    }
+
+    if (fields & FIELD(find_field("bandwidth", 9))) {
+        for (int i = 0; net_interfaces[i] != NULL; i++) {
+            snprintf(path, sizeof(path), "/sys/class/net/%s/operstate", net_interfaces[i]);
+            prefetch_add(path, PREFETCH_SIZE);
+            snprintf(path, sizeof(path), "/sys/class/net/%s/speed", net_interfaces[i]);
+            prefetch_add(path, PREFETCH_SIZE);
+        }
+    }
+
+    prefetch_read();
+#else
+    (void)fields;
+#endif
+}
+
+static void prefetch_free(void) {
+#ifdef ZENFETCH_IO_URING
+    free(prefetch_buffer);
+    prefetch_buffer = NULL;
+    prefetch_count = 0;
+#endif
+}
+
+// Values a layout can show besides the fields, numbered after them
+enum {
+    SOURCE_OWNER = FIELD_COUNT,
+    SOURCE_SUPPORT,
+    SOURCE_DOCS,
+    SOURCE_COUNT
+};
+
+static const char *const setting_sources[] = {"owner", "support", "docs"};
+
+typedef char source_count_fits_mask[SOURCE_COUNT <= 32 ? 1 : -1];
+
+// Source called name, -1 if there's none
+static int find_source(const char *name, size_t length) {
+    int field = find_field(name, length);
+    if (field >= 0) return field;
+    for (int i = 0; i < SOURCE_COUNT - FIELD_COUNT; i++) {
+        if (strlen(setting_sources[i]) == length && strncmp(setting_sources[i], name, length) == 0)
+            return FIELD_COUNT + i;
+    }
+    return -1;
+}
+
+// A layout is compiled into instructions run for every redraw of the block
+enum layout_op {
+    OP_LINE,   // a line starts; skip it unless one of sources is set
+    OP_TEXT,   // text as is
+    OP_VALUE,  // the value of source
+    OP_LINK,   // the value of source, linked if it looks like a link
+    OP_COLOR,  // an escape sequence, left out in noir mode
+    OP_GROUP,  // skip the group unless all of sources are set
+    OP_END     // the line ends
+};
+
+enum line_kind {
+    LINE_BLANK,
+    LINE_CENTER,  // centered on its own
+    LINE_INFO     // a label and a value, in the info column
+};
+
+struct instruction {
+    unsigned char op;
+    unsigned char arg;     // OP_LINE: the line_kind; OP_VALUE, OP_LINK: the source
+    unsigned short skip;   // OP_LINE, OP_GROUP: instructions to jump over
+    unsigned sources;      // OP_LINE, OP_GROUP: sources as a mask
+    unsigned start;        // text of OP_TEXT, OP_COLOR and the OP_LINE label,
+    unsigned length;       // in strings
+};
+
+struct layout {
+    struct instruction *code;
+    int count;
+    int capacity;
+    int sealed;  // text before this instruction can't be extended
+    struct frame strings;
+};
+
+#define MAX_GROUP_DEPTH 8
+
+static const struct {
+    const char *name;
+    const char *escape;
+} layout_colors[] = {
+    {"black", "\033[30m"}, {"red", "\033[31m"}, {"green", "\033[32m"}, {"yellow", "\033[33m"},
+    {"blue", "\033[34m"}, {"magenta", "\033[35m"}, {"cyan", "\033[36m"}, {"white", "\033[37m"},
+    {"bold", COLOR_BOLD}, {"reset", COLOR_RESET},
+};
+
+static struct instruction *layout_emit(struct layout *layout, enum layout_op op) {
+    if (layout->count == layout->capacity) {
+        int capacity = layout->capacity ? layout->capacity * 2 : 64;
+        struct instruction *code = realloc(layout->code, capacity * sizeof(*code));
+        if (!code) return NULL;
+        layout->code = code;
+        layout->capacity = capacity;
+    }
+    struct instruction *in = &layout->code[layout->count++];
+    memset(in, 0, sizeof(*in));
+    in->op = (unsigned char)op;
+    return in;
+}
+
+// Keep text in the layout's strings, extending the text just before it
+static int layout_text(struct layout *layout, enum layout_op op, const char *text, size_t length) {
+    struct instruction *last = layout->count ? &layout->code[layout->count - 1] : NULL;
+    if (!last || last->op != op || op != OP_TEXT || layout->count - 1 < layout->sealed ||
+        last->start + last->length != layout->strings.length) {
+        last = layout_emit(layout, op);
+        if (!last) return -1;
+        last->start = (unsigned)layout->strings.length;
+    }
+    frame_append(&layout->strings, text, length);
+    last->length += (unsigned)length;
+    return 0;
+}
+
+static void layout_free(struct layout *layout) {
+    free(layout->code);
+    free(layout->strings.data);
+    memset(layout, 0, sizeof(*layout));
+}
+
+// Compile the text of a line: {name} is a value, {link name} a value that
+// may be a link, {color name} switches color and [...] is left out unless
+// all the values in it are set; \ takes the next character as is. Returns
+// the values it shows, or the problem in *error
+static unsigned layout_line_text(struct layout *layout, const char *text, const char **error) {
+    int groups[MAX_GROUP_DEPTH];
+    unsigned group_sources[MAX_GROUP_DEPTH];
+    int depth = 0;
+    unsigned sources = 0;
+
+    while (*text) {
+        if (*text == '\\' && text[1]) {
+            if (layout_text(layout, OP_TEXT, text + 1, 1) != 0) goto no_memory;
+            text += 2;
+        } else if (*text == '[') {
+            if (depth == MAX_GROUP_DEPTH) {
+                *error = "groups nested too deep";
+                return 0;
+            }
+            groups[depth] = layout->count;
+            group_sources[depth++] = 0;
+            if (!layout_emit(layout, OP_GROUP)) goto no_memory;
+            layout->sealed = layout->count;
+            text++;
+        } else if (*text == ']') {
+            if (depth == 0) {
+                *error = "']' without '['";
+                return 0;
+            }
+            struct instruction *group = &layout->code[groups[--depth]];
+            group->skip = (unsigned short)(layout->count - groups[depth] - 1);
+            group->sources = group_sources[depth];
+            layout->sealed = layout->count;
+            text++;
+        } else if (*text == '{') {
+            const char *end = strchr(text, '}');
+            if (!end) {
+                *error = "'{' without '}'";
+                return 0;
+            }
+            const char *name = text + 1;
+            enum layout_op op = OP_VALUE;
+            if (strncmp(name, "link ", 5) == 0) {
+                op = OP_LINK;
+                name += 5;
+            } else if (strncmp(name, "color ", 6) == 0) {
+                name += 6;
+                size_t i = 0, count = sizeof(layout_colors) / sizeof(layout_colors[0]);
+                while (i < count && !(strlen(layout_colors[i].name) == (size_t)(end - name) &&
+                                      strncmp(layout_colors[i].name, name, end - name) == 0))
+                    i++;
+                if (i == count) {
+                    *error = "unknown color";
+                    return 0;
+                }
+                if (layout_text(layout, OP_COLOR, layout_colors[i].escape,
+                                strlen(layout_colors[i].escape)) != 0)
+                    goto no_memory;
+                text = end + 1;
+                continue;
+            }
+            int source = find_source(name, (size_t)(end - name));
+            if (source < 0) {
+                *error = "unknown value";
+                return 0;
+            }
+            struct instruction *value = layout_emit(layout, op);
+            if (!value) goto no_memory;
+            value->arg = (unsigned char)source;
+            sources |= FIELD(source);
+            if (depth) group_sources[depth - 1] |= FIELD(source);
+            text = end + 1;
+        } else {
+            size_t length = strcspn(text, "\\[]{");
+            if (length == 0) length = 1;
+            if (layout_text(layout, OP_TEXT, text, length) != 0) goto no_memory;
+            text += length;
+        }
+    }
+    if (depth) *error = "'[' without ']'";
+    return sources;
+
+no_memory:
+    *error = "out of memory";
+    return 0;
+}
+
+// Compile a line of a layout template, returns what's wrong with it if
+// anything is
+static const char *layout_line(struct layout *layout, const char *text) {
+    const char *error = NULL;
+
+    // Values one of which the line needs
+    unsigned wants = 0;
+    if (*text == '?') {
+        text++;
+        while (*text && *text != ' ') {
+            size_t length = strcspn(text, ", ");
+            int source = find_source(text, length);
+            if (source < 0) return "unknown value";
+            wants |= FIELD(source);
+            text += length;
+            if (*text == ',') text++;
+        }
+        text += strspn(text, " ");
+    }
+
+    int start = layout->count;
+    if (!layout_emit(layout, OP_LINE)) return "out of memory";
+
+    if (strcmp(text, "blank") == 0) {
+        layout->code[start].arg = LINE_BLANK;
+    } else if (strncmp(text, "center ", 7) == 0) {
+        layout->code[start].arg = LINE_CENTER;
+        layout_line_text(layout, text + 7, &error);
+    } else if (strncmp(text, "info ", 5) == 0) {
+        const char *label = text + 5;
+        const char *colon = strchr(label, ':');
+        if (!colon) return "info without a ':' after the label";
+        layout->code[start].arg = LINE_INFO;
+        layout->code[start].start = (unsigned)layout->strings.length;
+        layout->code[start].length = (unsigned)(colon - label);
+        frame_append(&layout->strings, label, (size_t)(colon - label));
+        unsigned shows = layout_line_text(layout, colon + 1 + strspn(colon + 1, " "), &error);
+        if (!wants) wants = shows;
+    } else {
+        return "expected center, info or blank";
+    }
+    if (error) return error;
+
+    if (!layout_emit(layout, OP_END)) return "out of memory";
+    layout->code[start].sources = wants;
+    layout->code[start].skip = (unsigned short)(layout->count - start - 1);
+    return NULL;
+}
+
+// Compile a layout template, a line of the info block per line of it:
+//   center TEXT          a line centered on its own
+//   info LABEL: TEXT     a labeled line, left out if all its values are unset
+//   blank                an empty line
+// Any of them can start with ?NAME,... to be left out unless one of those
+// values is set. Blank lines and lines starting with # don't count.
+// Complains about the first line it can't compile, or that's MAX_BUF bytes
+// or longer, and returns -1
+static int layout_compile(struct layout *layout, const char *template, const char *name) {
+    memset(layout, 0, sizeof(*layout));
+    char line[MAX_BUF];
+    int number = 0;
+
+    while (*template) {
+        size_t length = strcspn(template, "\n");
+        number++;
+        const char *error = NULL;
+        if (length < sizeof(line)) {
+            memcpy(line, template, length);
+            line[length] = 0;
+        } else {
+            error = "line too long";
+        }
+        template += length + (template[length] == '\n');
+
+        if (!error) {
+            line[strcspn(line, "\r")] = 0;
+            const char *text = line + strspn(line, " \t");
+            if (!*text || *text == '#') continue;
+            error = layout_line(layout, text);
+        }
+        if (error) {
+            printf("error: %s line %d: %s\n", name, number, error);
+            layout_free(layout);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// The layout zenfetch shows unless it's given one: every labeled field in
+// the order of the registry between the welcome and the support contacts
+static void default_layout(struct frame *out) {
+    frame_printf(out, "center welcome[ to {hostname}][ - {owner}]\nblank\n");
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (collectors[i].label) frame_printf(out, "info %s: {%s}\n", collectors[i].label, collectors[i].name);
+    }
+    frame_printf(out, "blank\ninfo SUPPORT: {link support}\ninfo DOCS: {link docs}\n?support,docs blank\n");
+}
+
+// Everything the info block shows about the system, filled in a field at a
+// time; ready says which fields are in
+struct system_info {
+    char value[FIELD_COUNT][MAX_BUF];
+    struct raw_values raw[FIELD_COUNT];
+    long long nanos[FIELD_COUNT];  // how long collecting each took
+    unsigned wanted;  // fields to collect
+    unsigned ready;
+#ifndef _WIN32
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+#endif
+};
+
+// Set up to collect the selected fields that have a collector here
+static void info_init(struct system_info *info, unsigned fields) {
+    memset(info, 0, sizeof(*info));
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if ((fields & FIELD(i)) && collectors[i].collect && (collectors[i].platforms & THIS_PLATFORM))
+            info->wanted |= FIELD(i);
+    }
+#ifndef _WIN32
+    pthread_mutex_init(&info->lock, NULL);
+    pthread_cond_init(&info->changed, NULL);
+#endif
+}
+
+static void info_free(struct system_info *info) {
+#ifndef _WIN32
+    pthread_mutex_destroy(&info->lock);
+    pthread_cond_destroy(&info->changed);
+#else
+    (void)info;
+#endif
+}
+
+// Mark a field as collected
+static void info_set_ready(struct system_info *info, int field) {
+#ifndef _WIN32
+    pthread_mutex_lock(&info->lock);
+    info->ready |= FIELD(field);
+    pthread_cond_broadcast(&info->changed);
+    pthread_mutex_unlock(&info->lock);
+#else
+    info->ready |= FIELD(field);
+#endif
+}
+
+// Wait up to ms milliseconds for every field; returns the fields ready
+static unsigned info_wait_all(struct system_info *info, int ms) {
+#ifndef _WIN32
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&info->lock);
+    while (info->ready != info->wanted &&
+           pthread_cond_timedwait(&info->changed, &info->lock, &deadline) == 0)
+        ;
+    unsigned ready = info->ready;
+    pthread_mutex_unlock(&info->lock);
+    return ready;
+#else
+    (void)ms;
+    return info->ready;
+#endif
+}
+
+// Wait for fields beyond those already seen; returns every field ready
+static unsigned info_wait(struct system_info *info, unsigned seen) {
+#ifndef _WIN32
+    pthread_mutex_lock(&info->lock);
+    while (info->ready == seen) pthread_cond_wait(&info->changed, &info->lock);
+    unsigned ready = info->ready;
+    pthread_mutex_unlock(&info->lock);
+    return ready;
+#else
+    (void)seen;
+    return info->ready;
+#endif
+}
+
+// Monotonic clock for timing collectors
+static long long now_nanos(void) {
+#ifdef _WIN32
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (long long)(count.QuadPart / frequency.QuadPart * 1000000000LL +
+                       count.QuadPart % frequency.QuadPart * 1000000000LL / frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+#endif
+}
+
+// Collect fields, cheapest first, timing each
+static void collect_fields(struct system_info *info, unsigned fields) {
+#ifndef _WIN32
+    // Format in the C locale whatever cbonsai sets meanwhile
+    locale_t c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    if (c_locale) uselocale(c_locale);
+#endif
+
+    for (int cost = 0; cost < COST_CLASSES; cost++) {
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            if (!(fields & FIELD(i)) || collectors[i].cost != (enum cost)cost) continue;
+            memset(&info->raw[i], 0, sizeof(info->raw[i]));
+            long long start = now_nanos();
+            collectors[i].collect(info->value[i], sizeof(info->value[i]), &info->raw[i]);
+            info->nanos[i] = now_nanos() - start;
+            info_set_ready(info, i);
+        }
+    }
+
+#ifndef _WIN32
+    if (c_locale) {
+        uselocale(LC_GLOBAL_LOCALE);
+        freelocale(c_locale);
+    }
+#endif
+}
+
+// Gather system info; fields nobody selected never run
+static void *collect_info(void *arg) {
+    struct system_info *info = arg;
+    collect_fields(info, info->wanted);
+    return NULL;
+}
+
+// What the banner says besides the system info
+struct banner_text {
+    char location[MAX_BUF], owner[MAX_BUF];
+    char support[MAX_BUF], docs[MAX_BUF];
+    int hide_support;
+    unsigned fields;  // fields selected to show
+    struct layout layout;
+};
+
+// The value of source as the block shows it, NULL if it's unset; fields
+// still being collected show as pending and are added to needs
+static const char *source_value(int source, const struct banner_text *text,
+                                const struct system_info *info, unsigned ready, unsigned *needs) {
+    switch (source) {
+        case SOURCE_OWNER: return text->owner[0] ? text->owner : NULL;
+        case SOURCE_SUPPORT: return !text->hide_support && text->support[0] ? text->support : NULL;
+        case SOURCE_DOCS: return !text->hide_support && text->docs[0] ? text->docs : NULL;
+    }
+    if (!collectors[source].collect) {
+        // the location is configured rather than collected
+        return (text->fields & FIELD(source)) && text->location[0] ? text->location : NULL;
+    }
+    if (!(info->wanted & FIELD(source))) return NULL;
+    if (!(ready & FIELD(source))) {
+        *needs |= FIELD(source);
+        return PENDING;
+    }
+    return info->value[source];
+}
+
+// Whether any (or all) of sources are set
+static int sources_set(unsigned sources, int all, const struct banner_text *text,
+                       const struct system_info *info, unsigned ready) {
+    unsigned needs = 0;
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        if (!(sources & FIELD(i))) continue;
+        int set = source_value(i, text, info, ready, &needs) != NULL;
+        if (set != all) return set;
+    }
+    return all;
+}
+
+// Build the info block from the fields ready so far by running the layout
+static void build_block(struct block *block, const struct banner_text *text,
+                        const struct system_info *info, unsigned ready) {
+    const struct layout *layout = &text->layout;
+    const char *label_style = noir_mode ? COLOR_BOLD : COLOR_CYAN;
+    struct frame *out = NULL;
+    int kind = LINE_BLANK, width = 0, colored = 0;
+    unsigned needs = 0;
+
+    block->count = 0;
+    block->text.length = 0;
+
+    for (int pc = 0; pc < layout->count; pc++) {
+        const struct instruction *in = &layout->code[pc];
+        const char *value;
+        switch ((enum layout_op)in->op) {
+            case OP_LINE:
+                out = NULL;
+                if (!in->sources || sources_set(in->sources, 0, text, info, ready))
+                    out = block_line(block, in->arg == LINE_INFO ? BLOCK_WIDTH : 0);
+                if (!out) {
+                    pc += in->skip;
+                    break;
+                }
+                kind = in->arg;
+                width = 0;
+                colored = 0;
+                needs = 0;
+                if (kind == LINE_INFO) {
+                    frame_printf(out, "%s%-*.*s" COLOR_RESET " ", label_style, LABEL_WIDTH,
+                                 (int)in->length, layout->strings.data + in->start);
+                }
+                break;
+            case OP_TEXT:
+                frame_append(out, layout->strings.data + in->start, in->length);
+                width += (int)in->length;
+                break;
+            case OP_VALUE:
+            case OP_LINK:
+                value = source_value(in->arg, text, info, ready, &needs);
+                if (!value) break;
+                if (in->op == OP_LINK) {
+                    frame_link(out, value);
+                } else {
+                    frame_append(out, value, strlen(value));
+                }
+                width += (int)strlen(value);
+                break;
+            case OP_COLOR:
+                if (noir_mode) break;
+                frame_append(out, layout->strings.data + in->start, in->length);
+                colored = 1;
+                break;
+            case OP_GROUP:
+                if (!sources_set(in->sources, 1, text, info, ready)) pc += in->skip;
+                break;
+            case OP_END:
+                if (colored) frame_append(out, COLOR_RESET, strlen(COLOR_RESET));
+                if (kind == LINE_CENTER) block->lines[block->count].width = width;
+                block->lines[block->count].needs = needs;
+                block_end(block);
+                break;
+        }
+    }
+}
+
+// Make copy the same as block, to tell later which lines changed
+static void block_copy(struct block *copy, const struct block *block) {
+    copy->count = block->count;
+    copy->text.length = 0;
+    frame_append(&copy->text, block->text.data, block->text.length);
+    memcpy(copy->lines, block->lines, sizeof(block->lines));
+}
+
+// Lines of the block, from the top, that are final
+static int block_final_lines(const struct block *block) {
+    int i = 0;
+    while (i < block->count && !block->lines[i].needs) i++;
+    return i;
+}
+
+// A JSON string of value, escaped as it's appended
+static void json_string(struct frame *out, const char *value) {
+    frame_append(out, "\"", 1);
+    const char *run = value;
+    for (const char *p = value; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        frame_append(out, run, (size_t)(p - run));
+        switch (c) {
+            case '"': frame_append(out, "\\\"", 2); break;
+            case '\\': frame_append(out, "\\\\", 2); break;
+            case '\n': frame_append(out, "\\n", 2); break;
+            case '\t': frame_append(out, "\\t", 2); break;
+            default: frame_printf(out, "\\u%04x", c); break;
+        }
+        run = p + 1;
+    }
+    frame_append(out, run, strlen(run));
+    frame_append(out, "\"", 1);
+}
+
+// One "name": value member, after a comma unless it's the first
+static void json_key(struct frame *out, const char *name, int *first) {
+    if (!*first) frame_append(out, ", ", 2);
+    *first = 0;
+    json_string(out, name);
+    frame_append(out, ": ", 2);
+}
+
+// Collected fields as a JSON object, each with its value as shown, the raw
+// values behind it, why it's unknown if it is, and how long it took
+static void compose_json(struct frame *out, const struct banner_text *text,
+                         const struct system_info *info) {
+    frame_append(out, "{\n  \"fields\": {", 15);
+    int first_field = 1;
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (!(text->fields & FIELD(i))) continue;
+        int collected = (info->wanted & FIELD(i)) != 0;
+        if (!collected && collectors[i].collect) continue;  // not on this platform
+
+        frame_append(out, first_field ? "\n    " : ",\n    ", first_field ? 5 : 6);
+        first_field = 0;
+        json_string(out, collectors[i].name);
+        frame_append(out, ": {", 3);
+
+        int first = 1;
+        json_key(out, "value", &first);
+        const char *value = collected ? info->value[i] : text->location;
+        if (collected || value[0]) json_string(out, value);
+        else frame_append(out, "null", 4);
+
+        if (!collected) {
+            if (!value[0]) {
+                json_key(out, "error", &first);
+                json_string(out, "not configured");
+            }
+            frame_append(out, "}", 1);
+            continue;
+        }
+        const struct raw_values *raw = &info->raw[i];
+        for (int j = 0; j < raw->count; j++) {
+            json_key(out, raw->values[j].name, &first);
+            if (raw->values[j].is_text) json_string(out, raw->values[j].text);
+            else frame_printf(out, "%lld", raw->values[j].number);
+        }
+        if (raw->error) {
+            json_key(out, "error", &first);
+            json_string(out, raw->error);
+        }
+        json_key(out, "latency_ns", &first);
+        frame_printf(out, "%lld}", info->nanos[i]);
+    }
+    frame_append(out, "\n  }", 4);
+
+    // the banner's own text, as it would show
+    unsigned needs = 0;
+    for (int i = SOURCE_OWNER; i < SOURCE_COUNT; i++) {
+        const char *value = source_value(i, text, info, info->wanted, &needs);
+        if (!value) continue;
+        frame_append(out, ",\n  ", 4);
+        json_string(out, setting_sources[i - FIELD_COUNT]);
+        frame_append(out, ": ", 2);
+        json_string(out, value);
+    }
+    frame_append(out, "\n}\n", 3);
+}
+
+// A megabit a second is 1000000 bits, 8 to the byte
+#define BYTES_PER_SECOND_PER_MBPS 125000
+
+// A Prometheus label value, escaped as it's appended
+static void prom_label_value(struct frame *out, const char *value) {
+    const char *run = value;
+    for (const char *p = value; *p; p++) {
+        if (*p != '"' && *p != '\\' && *p != '\n') continue;
+        frame_append(out, run, (size_t)(p - run));
+        frame_append(out, *p == '"' ? "\\\"" : *p == '\\' ? "\\\\" : "\\n", 2);
+        run = p + 1;
+    }
+    frame_append(out, run, strlen(run));
+}
+
+// The text raw values of a field, as the labels of its metrics
+static void prom_labels(struct frame *out, const struct raw_values *raw) {
+    int first = 1;
+    for (int i = 0; i < raw->count; i++) {
+        if (!raw->values[i].is_text) continue;
+        frame_printf(out, "%s%s=\"", first ? "{" : ",", raw->values[i].name);
+        prom_label_value(out, raw->values[i].text);
+        frame_append(out, "\"", 1);
+        first = 0;
+    }
+    if (!first) frame_append(out, "}", 1);
+}
+
+// Collected fields as Prometheus gauges: zenfetch_FIELD_NAME for each raw
+// number, labeled with the field's raw strings, or zenfetch_FIELD_info 1 if
+// it has only strings; then how long each field took and whether it worked
+static void compose_prometheus(struct frame *out, const struct banner_text *text,
+                               const struct system_info *info) {
+    unsigned fields = text->fields & info->wanted;
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (!(fields & FIELD(i))) continue;
+        const struct raw_values *raw = &info->raw[i];
+        int numbers = 0, strings = 0;
+        for (int j = 0; j < raw->count; j++) {
+            const struct raw_value *value = &raw->values[j];
+            if (value->is_text) {
+                strings++;
+                continue;
+            }
+            numbers++;
+
+            // metrics are in base units: link speeds go as bytes per second
+            char name[MAX_NAME * 2];
+            long long number = value->number;
+            size_t length = strlen(value->name);
+            if (length > 5 && strcmp(value->name + length - 5, "_mbps") == 0) {
+                snprintf(name, sizeof(name), "zenfetch_%s_%.*s_bytes_per_second",
+                         collectors[i].name, (int)(length - 5), value->name);
+                number *= BYTES_PER_SECOND_PER_MBPS;
+            } else {
+                snprintf(name, sizeof(name), "zenfetch_%s_%s", collectors[i].name, value->name);
+            }
+            frame_printf(out, "# HELP %s %s of the %s field.\n# TYPE %s gauge\n%s",
+                         name, value->name, collectors[i].name, name, name);
+            prom_labels(out, raw);
+            frame_printf(out, " %lld\n", number);
+        }
+        if (strings && !numbers) {
+            frame_printf(out, "# HELP zenfetch_%s_info The %s field, in labels.\n"
+                         "# TYPE zenfetch_%s_info gauge\nzenfetch_%s_info",
+                         collectors[i].name, collectors[i].name,
+                         collectors[i].name, collectors[i].name);
+            prom_labels(out, raw);
+            frame_append(out, " 1\n", 3);
+        }
+    }
+
+    frame_printf(out, "# HELP zenfetch_collector_duration_seconds How long collecting the field took.\n"
+                 "# TYPE zenfetch_collector_duration_seconds gauge\n");
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (!(fields & FIELD(i))) continue;
+        frame_printf(out, "zenfetch_collector_duration_seconds{collector=\"%s\"} %lld.%09lld\n",
+                     collectors[i].name, info->nanos[i] / 1000000000, info->nanos[i] % 1000000000);
+    }
+    frame_printf(out, "# HELP zenfetch_collector_success Whether collecting the field worked.\n"
+                 "# TYPE zenfetch_collector_success gauge\n");
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (!(fields & FIELD(i))) continue;
+        frame_printf(out, "zenfetch_collector_success{collector=\"%s\"} %d\n",
+                     collectors[i].name, info->raw[i].error ? 0 : 1);
+    }
+}
+
+// Write metrics to DIR/zenfetch.prom for node_exporter's textfile collector;
+// they're written aside and renamed over it, so no scrape sees half of them
+static int write_textfile(const char *dir, const struct frame *metrics) {
+    char path[MAX_PATH_LEN], temp[MAX_PATH_LEN];
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = (unsigned long)getpid();
+#endif
+    snprintf(path, sizeof(path), "%s" PATH_SEP "zenfetch.prom", dir);
+    snprintf(temp, sizeof(temp), "%s" PATH_SEP ".zenfetch.prom.%lu", dir, pid);
+
+    FILE *f = fopen(temp, "wb");
+    if (!f) {
+        printf("error: can't write '%s'\n", temp);
+        return 1;
+    }
+    int failed = fwrite(metrics->data, 1, metrics->length, f) != metrics->length || fflush(f) != 0;
+#ifndef _WIN32
+    failed = failed || fsync(fileno(f)) != 0;
+#endif
+    failed = fclose(f) != 0 || failed;
+#ifdef _WIN32
+    failed = failed || !MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    failed = failed || rename(temp, path) != 0;
+#endif
+    if (failed) {
+        remove(temp);
+        printf("error: can't write '%s'\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+static volatile sig_atomic_t serving = 1;
+
+static void stop_serving(int sig) {
+    (void)sig;
+    serving = 0;
+}
+
+// Send all of data, unless the peer goes away
+static void send_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return;
+        data += sent;
+        length -= (size_t)sent;
+    }
+}
+
+// Serve metrics on a Unix socket at path until SIGINT or SIGTERM, collected
+// afresh for every connection; a client that asks with an HTTP GET gets an
+// HTTP response, any other gets the metrics alone
+static int serve_metrics(const char *path, const struct banner_text *text) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("error: socket path too long: '%s'\n", path);
+        return 1;
+    }
+    memcpy(address.sun_path, path, strlen(path));
+
+    // a socket left by an earlier run is replaced, anything else isn't
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(listener, 16) != 0) {
+        printf("error: can't listen on '%s': %s\n", path, strerror(errno));
+        if (listener >= 0) close(listener);
+        return 1;
+    }
+
+    // no SA_RESTART, so a signal wakes accept() up
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_serving;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    struct frame metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    static const char http_header[] =
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Connection: close\r\n"
+        "\r\n";
+    int status = 0;
+    while (serving) {
+        int client = accept(listener, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            printf("error: can't accept on '%s': %s\n", path, strerror(errno));
+            status = 1;
+            break;
+        }
+
+        // the request, if the client sends one straight away
+        char request[1024];
+        struct pollfd waiting = {client, POLLIN, 0};
+        ssize_t got = poll(&waiting, 1, 100) > 0 ? recv(client, request, sizeof(request), 0) : 0;
+
+        struct system_info info;
+        info_init(&info, text->fields);
+        collect_info(&info);
+        metrics.length = 0;
+        if (got >= 4 && memcmp(request, "GET ", 4) == 0)
+            frame_append(&metrics, http_header, sizeof(http_header) - 1);
+        compose_prometheus(&metrics, text, &info);
+        info_free(&info);
+
+        send_all(client, metrics.data, metrics.length);
+        close(client);
+    }
+
+    close(listener);
+    unlink(path);
+    free(metrics.data);
+    return status;
+}
+#endif
+
 #ifdef _WIN32
 // Simple argument parsing for Windows (no getopt_long)
 static int parse_args(int argc, char *argv[],
                       char **cli_owner, char **cli_location,
-                      char **cli_support, char **cli_docs,
-                      int *hide_support, int *hide_ip) {
+                      char **cli_support, char **cli_docs, char **cli_fields,
+                      char **cli_prometheus, int *hide_support, int *hide_ip) {
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             print_help();
@@ -758,6 +2482,12 @@ static int parse_args(int argc, char *argv[],
         else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--print") == 0) {
             print_mode = 1;
         }
+        else if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--beside") == 0) {
+            beside_mode = 1;
+        }
+        else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--json") == 0) {
+            json_mode = 1;
+        }
         else if (strcmp(argv[i], "-S") == 0 || strcmp(argv[i], "--no-support") == 0) {
             *hide_support = 1;
         }
@@ -776,23 +2506,29 @@ static int parse_args(int argc, char *argv[],
         else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--docs") == 0) && i + 1 < argc) {
             *cli_docs = argv[++i];
         }
+        else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--fields") == 0) && i + 1 < argc) {
+            *cli_fields = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--prometheus") == 0) && i + 1 < argc) {
+            *cli_prometheus = argv[++i];
+        }
     }
     return 0;
 }
 #endif
 
 int main(int argc, char *argv[]) {
-    char cpu[MAX_BUF], memory[MAX_BUF], storage[MAX_BUF];
-    char bandwidth[MAX_BUF], ip[MAX_BUF], local_time[MAX_BUF];
-    char location[MAX_BUF], owner[MAX_BUF], os[MAX_BUF];
-    char hostname[MAX_BUF], uptime[MAX_BUF];
-    char support[MAX_BUF], docs[MAX_BUF];
+    struct system_info info;
+    struct banner_text text;
 
     // CLI overrides (NULL = use config file)
     char *cli_owner = NULL;
     char *cli_location = NULL;
     char *cli_support = NULL;
     char *cli_docs = NULL;
+    char *cli_fields = NULL;
+    char *cli_prometheus = NULL;  // textfile directory
+    char *cli_serve = NULL;       // Unix socket path
     int hide_support = 0;
     int hide_ip = 0;
 
@@ -806,7 +2542,7 @@ int main(int argc, char *argv[]) {
 
     // Parse arguments
     if (parse_args(argc, argv, &cli_owner, &cli_location, &cli_support, &cli_docs,
-                   &hide_support, &hide_ip)) {
+                   &cli_fields, &cli_prometheus, &hide_support, &hide_ip)) {
         return 0;  // Help was shown
     }
 #else
@@ -816,25 +2552,40 @@ int main(int argc, char *argv[]) {
         {"location",   required_argument, NULL, 'L'},
         {"support",    required_argument, NULL, 's'},
         {"docs",       required_argument, NULL, 'd'},
+        {"fields",     required_argument, NULL, 'f'},
         {"no-support", no_argument,       NULL, 'S'},
         {"hide-ip",    no_argument,       NULL, 'I'},
         {"noir",       no_argument,       NULL, 'n'},
         {"print",      no_argument,       NULL, 'p'},
+        {"beside",     no_argument,       NULL, 'b'},
+        {"json",       no_argument,       NULL, 'j'},
+        {"prometheus", required_argument, NULL, 'P'},
+        {"serve",      required_argument, NULL, 'U'},
+        {"watch",      required_argument, NULL, 'w'},
         {"help",       no_argument,       NULL, 'h'},
         {0, 0, 0, 0}
     };
 
     int c;
-    while ((c = getopt_long(argc, argv, "o:L:s:d:SInph", long_options, NULL)) != -1) {
+    while ((c = getopt_long(argc, argv, "o:L:s:d:f:P:U:w:SInpbjh", long_options, NULL)) != -1) {
         switch (c) {
             case 'o': cli_owner = optarg; break;
             case 'L': cli_location = optarg; break;
             case 's': cli_support = optarg; break;
             case 'd': cli_docs = optarg; break;
+            case 'f': cli_fields = optarg; break;
+            case 'P': cli_prometheus = optarg; break;
+            case 'U': cli_serve = optarg; break;
+            case 'w':
+                watch_ms = parse_interval(optarg);
+                if (watch_ms < 0) return 1;
+                break;
             case 'S': hide_support = 1; break;
             case 'I': hide_ip = 1; break;
             case 'n': noir_mode = 1; break;
             case 'p': print_mode = 1; break;
+            case 'b': beside_mode = 1; break;
+            case 'j': json_mode = 1; break;
             case 'h':
                 print_help();
                 return 0;
@@ -843,81 +2594,237 @@ int main(int argc, char *argv[]) {
                 return 1;
         }
     }
+    if (watch_ms && !isatty(STDOUT_FILENO)) {
+        printf("error: --watch needs a terminal\n");
+        return 1;
+    }
+#endif
+
+    // Fields picked on the command line, to read only what they need
+    unsigned cli_mask = ALL_FIELDS;
+    if (cli_fields && cli_fields[0] && parse_fields(cli_fields, &cli_mask) != 0) return 1;
+    prefetch_files(cli_mask);
+
+    // Read the config, then apply CLI overrides
+    struct settings settings;
+    read_settings(&settings);
+    memset(&text, 0, sizeof(text));
+    memcpy(text.location, settings.location, sizeof(text.location));
+    memcpy(text.owner, settings.owner, sizeof(text.owner));
+    memcpy(text.support, settings.support, sizeof(text.support));
+    memcpy(text.docs, settings.docs, sizeof(text.docs));
+
+    if (cli_owner) strncpy(text.owner, cli_owner, sizeof(text.owner) - 1);
+    if (cli_location) strncpy(text.location, cli_location, sizeof(text.location) - 1);
+    if (cli_support) strncpy(text.support, cli_support, sizeof(text.support) - 1);
+    if (cli_docs) strncpy(text.docs, cli_docs, sizeof(text.docs) - 1);
+    text.hide_support = hide_support;
+
+    // Every field unless some are picked; hiding the IP skips collecting it
+    text.fields = cli_mask;
+    if (!cli_fields && settings.fields[0] && parse_fields(settings.fields, &text.fields) != 0) return 1;
+    if (hide_ip) text.fields &= ~FIELD(find_field("ip", 2));
+
+    // No tree for JSON, just every field once it's collected
+    if (json_mode) {
+        info_init(&info, text.fields);
+        collect_info(&info);
+        struct frame json;
+        memset(&json, 0, sizeof(json));
+        compose_json(&json, &text, &info);
+        frame_write(&json, 1);
+        free(json.data);
+        info_free(&info);
+        prefetch_free();
+        return 0;
+    }
+
+    // Metrics, once to a textfile or to every client of a socket
+    if (cli_prometheus) {
+        info_init(&info, text.fields);
+        collect_info(&info);
+        struct frame metrics;
+        memset(&metrics, 0, sizeof(metrics));
+        compose_prometheus(&metrics, &text, &info);
+        int status = write_textfile(cli_prometheus, &metrics);
+        free(metrics.data);
+        info_free(&info);
+        prefetch_free();
+        return status;
+    }
+#ifndef _WIN32
+    if (cli_serve) {
+        prefetch_free();  // every connection reads the files afresh
+        return serve_metrics(cli_serve, &text);
+    }
+#endif
+
+    // The layout is compiled once, for every redraw of the block
+    struct frame template;
+    memset(&template, 0, sizeof(template));
+    if (!settings.layout[0]) {
+        default_layout(&template);
+        frame_append(&template, "", 1);
+    } else if (read_file(settings.layout, &template) != 0) {
+        printf("error: can't read layout: '%s'\n", settings.layout);
+        return 1;
+    }
+    int compiled = template.data ? layout_compile(&text.layout, template.data,
+                                                  settings.layout[0] ? settings.layout : "layout") : -1;
+    free(template.data);
+    if (compiled != 0) return 1;
+
+    // Gather system info while the tree grows; without threads, before it
+    info_init(&info, text.fields);
+#ifndef _WIN32
+    // Signals (resizes, ^C) are left for cbonsai's thread to take
+    sigset_t all_signals, old_signals;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &old_signals);
+    pthread_t collector;
+    int collecting = pthread_create(&collector, NULL, collect_info, &info) == 0;
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    if (!collecting) collect_info(&info);
+#else
+    collect_info(&info);
+#endif
+
+    // Get terminal size for centering
+    int term_width, term_height;
+    get_term_size(&term_width, &term_height);
+
+    // Info goes beside the tree only if both fit, and the tree is printed
+    int tree_width = term_width - BLOCK_WIDTH - 4;
+    int beside = beside_mode && print_mode && tree_width >= MIN_TREE_WIDTH;
+
+    // Display bonsai tree; animating, it's drawn straight to the terminal
+    struct frame frames[3];
+    memset(frames, 0, sizeof(frames));
+    frame_append(&frames[0], "\n", 1);
+    if (!print_mode) {
+        frame_write(frames, 1);
+        frames[0].length = 0;
+    }
+
+    size_t tree_length;
+    char *tree = run_cbonsai(beside ? term_height - 1 : 0, beside ? tree_width : 0, &tree_length);
+    frames[1].data = tree;
+    frames[1].length = tree_length;
+
+    // Whatever is collected within a moment goes out with the tree. On a
+    // terminal, fields still missing are shown pending and filled in as they
+    // come; elsewhere lines go out in order once they're final. Beside the
+    // tree, lines can't go out in order, so a pipe waits for all of them
+#ifndef _WIN32
+    int streaming = collecting && !(beside && tree && !isatty(STDOUT_FILENO));
+    int in_place = isatty(STDOUT_FILENO);
+#else
+    int streaming = 0;
+    int in_place = 0;
 #endif
+    unsigned ready = streaming ? info_wait_all(&info, STREAM_GRACE_MS) : info.wanted;
+    if (!streaming) {
+#ifndef _WIN32
+        if (collecting) pthread_join(collector, NULL);
+        collecting = 0;
+#endif
+    }
 
-    // Gather system info
-    get_cpu_info(cpu, sizeof(cpu));
-    get_memory_info(memory, sizeof(memory));
-    get_storage_info(storage, sizeof(storage));
-    get_network_bandwidth(bandwidth, sizeof(bandwidth));
-    get_ip_address(ip, sizeof(ip));
-    get_local_time(local_time, sizeof(local_time));
-    get_os_info(os, sizeof(os));
-    get_hostname(hostname, sizeof(hostname));
-    lowercase(hostname);  // lowercase for welcome message
-    get_uptime(uptime, sizeof(uptime));
+    struct block block;
+    memset(&block, 0, sizeof(block));
+    build_block(&block, &text, &info, ready);
 
-    // Read config files, then apply CLI overrides
-    read_config(CONFIG_LOCATION, location, sizeof(location), "");
-    read_config(CONFIG_OWNER, owner, sizeof(owner), "");
-    read_config(CONFIG_SUPPORT, support, sizeof(support), "");
-    read_config(CONFIG_DOCS, docs, sizeof(docs), "");
+    struct placement place;
+    if (ready == info.wanted || in_place) {
+        if (tree && beside) {
+            compose_beside(&frames[2], tree, tree_length, &block, tree_width + 3, &place);
+        } else {
+            compose_below(&frames[2], &block, term_width, &place);
+        }
+        frame_write(frames, 3);
+
+        struct block shown;
+        memset(&shown, 0, sizeof(shown));
+        while (ready != info.wanted) {
+            ready = info_wait(&info, ready);
+            block_copy(&shown, &block);
+            build_block(&block, &text, &info, ready);
+
+            frames[2].length = 0;
+            compose_update(&frames[2], &shown, &block, &place, term_height);
+            frame_write(&frames[2], 1);
+        }
 
-    if (cli_owner) strncpy(owner, cli_owner, sizeof(owner) - 1);
-    if (cli_location) strncpy(location, cli_location, sizeof(location) - 1);
-    if (cli_support) strncpy(support, cli_support, sizeof(support) - 1);
-    if (cli_docs) strncpy(docs, cli_docs, sizeof(docs) - 1);
+#ifndef _WIN32
+        // Watching, the live fields are collected again every interval from
+        // files kept open, and the lines that changed are redrawn
+        if (watch_ms) {
+            if (collecting) pthread_join(collector, NULL);
+            collecting = 0;
+            keep_files = 1;
+            unsigned live = 0;
+            for (int i = 0; i < FIELD_COUNT; i++) {
+                if (collectors[i].live && (info.wanted & FIELD(i))) live |= FIELD(i);
+            }
 
-    // Get terminal width for centering
-    int term_width = get_term_width();
+            long long tick = now_nanos();
+            while (live) {
+                // ticks keep to the interval however long collecting takes
+                tick += watch_ms * 1000000LL;
+                long long wait = tick - now_nanos();
+                if (wait > 0) {
+                    struct timespec pause = {(time_t)(wait / 1000000000), (long)(wait % 1000000000)};
+                    while (nanosleep(&pause, &pause) != 0 && errno == EINTR) {}
+                } else {
+                    tick = now_nanos();
+                }
 
-    // Display bonsai tree
-    printf("\n");
-    run_cbonsai();
+                collect_fields(&info, live);
+                block_copy(&shown, &block);
+                build_block(&block, &text, &info, ready);
 
-    // Welcome message
-    char welcome[256];
-    if (owner[0]) {
-        snprintf(welcome, sizeof(welcome), "welcome to %.100s - %.100s", hostname, owner);
+                frames[2].length = 0;
+                compose_update(&frames[2], &shown, &block, &place, term_height);
+                if (frames[2].length) frame_write(&frames[2], 1);
+            }
+            kept_close();
+        }
+#endif
+        free(shown.text.data);
     } else {
-        snprintf(welcome, sizeof(welcome), "welcome to %.100s", hostname);
-    }
-    print_centered(term_width, welcome);
-    printf("\n");
-
-    // System info
-    print_info(term_width, "OS", os);
-    print_info(term_width, "UPTIME", uptime);
-    print_info(term_width, "HARDWARE", cpu);
-    print_info(term_width, "MEMORY", memory);
-    print_info(term_width, "STORAGE", storage);
-    print_info(term_width, "NETWORK BANDWIDTH", bandwidth);
-    if (!hide_ip) print_info(term_width, "NODE IP", ip);
-    if (location[0]) print_info(term_width, "LOCATION", location);
-    print_info(term_width, "LOCAL TIME", local_time);
-    printf("\n");
-
-    // Support info (if not hidden and at least one is set)
-    // Use clickable links for URLs and emails
-    if (!hide_support && (support[0] || docs[0])) {
-        if (support[0]) {
-            if (looks_like_email(support))
-                print_link(term_width, "SUPPORT", support, 1);
-            else if (looks_like_url(support))
-                print_link(term_width, "SUPPORT", support, 0);
-            else
-                print_info(term_width, "SUPPORT", support);
-        }
-        if (docs[0]) {
-            if (looks_like_email(docs))
-                print_link(term_width, "DOCS", docs, 1);
-            else if (looks_like_url(docs))
-                print_link(term_width, "DOCS", docs, 0);
-            else
-                print_info(term_width, "DOCS", docs);
-        }
-        printf("\n");
+        // Lines in order, as each and those above it are final
+        int sent = block_final_lines(&block);
+        struct block head = block;
+        head.count = sent;
+        compose_below(&frames[2], &head, term_width, &place);
+        frame_write(frames, 3);
+
+        while (sent < block.count) {
+            ready = info_wait(&info, ready);
+            build_block(&block, &text, &info, ready);
+            int final = block_final_lines(&block);
+
+            frames[2].length = 0;
+            for (int i = sent; i < final; i++) {
+                compose_line(&frames[2], &block, i, &place);
+                frame_append(&frames[2], "\n", 1);
+            }
+            frame_write(&frames[2], 1);
+            sent = final;
+        }
     }
 
+#ifndef _WIN32
+    if (collecting) pthread_join(collector, NULL);
+#endif
+    info_free(&info);
+    prefetch_free();
+    layout_free(&text.layout);
+
+    free(frames[0].data);
+    free(tree);
+    free(frames[2].data);
+    free(block.text.data);
+
     return 0;
 }